@@ -0,0 +1,464 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "kaguya/config.hpp"
+
+namespace kaguya
+{
+	/**
+	* Allocators for State.
+	* Allocator type must have following member functions.
+	* @code
+	* void* allocate(size_t size);
+	* void* reallocate(void* ptr, size_t old_size, size_t new_size);
+	* void deallocate(void* ptr, size_t size);
+	* @endcode
+	* allocate and reallocate return null on failure. reallocate must not fail when new_size <= old_size.
+	*/
+
+	//! lua_Alloc adapter for allocator type
+	template<typename Allocator>
+	struct AllocatorFunction
+	{
+		static void* call(void* ud, void* ptr, size_t osize, size_t nsize)
+		{
+			Allocator* allocator = static_cast<Allocator*>(ud);
+			if (nsize == 0)
+			{
+				if (ptr)
+				{
+					allocator->deallocate(ptr, osize);
+				}
+				return 0;
+			}
+			if (!ptr)
+			{//osize is type tag on Lua5.2 or later
+				return allocator->allocate(nsize);
+			}
+			return allocator->reallocate(ptr, osize, nsize);
+		}
+	};
+
+	//! allocator using std::malloc,std::realloc and std::free
+	struct DefaultAllocator
+	{
+		void* allocate(size_t size)
+		{
+			return std::malloc(size);
+		}
+		void* reallocate(void* ptr, size_t old_size, size_t new_size)
+		{
+			void* result = std::realloc(ptr, new_size);
+			if (!result && new_size <= old_size)
+			{
+				return ptr;
+			}
+			return result;
+		}
+		void deallocate(void* ptr, size_t size)
+		{
+			std::free(ptr);
+		}
+	};
+
+	/**
+	* Size class pool allocator for Lua small objects.
+	* Objects up to MAX_POOLED_SIZE bytes are carved from large chunks and recycled by free list.
+	* Larger objects use std::malloc.Memory of chunks is released when allocator is destroyed.
+	* Not thread safe. Do not share between States used from different threads.
+	*/
+	class PoolAllocator
+	{
+	public:
+		static const size_t GRANULARITY = 16;
+		static const size_t MAX_POOLED_SIZE = 256;
+		static const size_t CLASS_COUNT = MAX_POOLED_SIZE / GRANULARITY;
+
+		explicit PoolAllocator(size_t chunk_size = 64 * 1024) :chunk_size_(chunk_size)
+		{
+			for (size_t i = 0; i < CLASS_COUNT; ++i)
+			{
+				free_list_[i] = 0;
+			}
+		}
+		~PoolAllocator()
+		{
+			for (size_t i = 0; i < chunks_.size(); ++i)
+			{
+				std::free(chunks_[i]);
+			}
+		}
+
+		void* allocate(size_t size)
+		{
+			if (size > MAX_POOLED_SIZE)
+			{
+				return std::malloc(size);
+			}
+			size_t index = sizeClass(size);
+			FreeNode* node = free_list_[index];
+			if (!node)
+			{
+				node = refill(index);
+				if (!node) { return 0; }
+			}
+			free_list_[index] = node->next;
+			return node;
+		}
+		void* reallocate(void* ptr, size_t old_size, size_t new_size)
+		{
+			if (old_size > MAX_POOLED_SIZE && new_size > MAX_POOLED_SIZE)
+			{
+				void* result = std::realloc(ptr, new_size);
+				if (!result && new_size <= old_size)
+				{
+					return ptr;
+				}
+				return result;
+			}
+			if (old_size <= MAX_POOLED_SIZE && new_size <= MAX_POOLED_SIZE
+				&& sizeClass(old_size) == sizeClass(new_size))
+			{
+				return ptr;
+			}
+			void* result = allocate(new_size);
+			if (!result)
+			{
+				//block is large enough for shrink
+				return new_size <= old_size ? ptr : 0;
+			}
+			std::memcpy(result, ptr, old_size < new_size ? old_size : new_size);
+			deallocate(ptr, old_size);
+			return result;
+		}
+		void deallocate(void* ptr, size_t size)
+		{
+			if (size > MAX_POOLED_SIZE)
+			{
+				std::free(ptr);
+				return;
+			}
+			size_t index = sizeClass(size);
+			FreeNode* node = static_cast<FreeNode*>(ptr);
+			node->next = free_list_[index];
+			free_list_[index] = node;
+		}
+
+		//! return number of chunks allocated from system
+		size_t chunkCount()const { return chunks_.size(); }
+	private:
+		//non copyable
+		PoolAllocator(const PoolAllocator&);
+		PoolAllocator& operator =(const PoolAllocator&);
+
+		struct FreeNode
+		{
+			FreeNode* next;
+		};
+		static size_t sizeClass(size_t size)
+		{
+			return (size + GRANULARITY - 1) / GRANULARITY - 1;
+		}
+		FreeNode* refill(size_t index)
+		{
+			size_t block_size = (index + 1) * GRANULARITY;
+			size_t count = chunk_size_ / block_size;
+			if (count == 0) { count = 1; }
+			char* chunk = static_cast<char*>(std::malloc(block_size * count));
+			if (!chunk)
+			{
+				return 0;
+			}
+			chunks_.push_back(chunk);
+			for (size_t i = 0; i < count; ++i)
+			{
+				FreeNode* node = reinterpret_cast<FreeNode*>(chunk + i * block_size);
+				node->next = (i + 1 < count) ? reinterpret_cast<FreeNode*>(chunk + (i + 1) * block_size) : 0;
+			}
+			return reinterpret_cast<FreeNode*>(chunk);
+		}
+
+		size_t chunk_size_;
+		FreeNode* free_list_[CLASS_COUNT];
+		std::vector<char*> chunks_;
+	};
+
+	/**
+	* Bump pointer arena allocator for short lived States.
+	* Freed memory is reused only when it is the last allocation.
+	* All memory is released at once when allocator is destroyed (after lua_close).
+	* Not thread safe.
+	*/
+	class ArenaAllocator
+	{
+	public:
+		static const size_t ALIGNMENT = 16;
+
+		explicit ArenaAllocator(size_t chunk_size = 256 * 1024) :chunk_size_(chunk_size), top_(0), end_(0), last_(0), used_(0)
+		{
+		}
+		~ArenaAllocator()
+		{
+			for (size_t i = 0; i < chunks_.size(); ++i)
+			{
+				std::free(chunks_[i]);
+			}
+		}
+
+		void* allocate(size_t size)
+		{
+			size_t aligned = alignSize(size);
+			if (aligned > chunk_size_ / 2)
+			{//dedicated chunk.keep current chunk
+				char* chunk = newChunk(aligned);
+				if (chunk) { used_ += aligned; }
+				return chunk;
+			}
+			if (aligned > size_t(end_ - top_))
+			{
+				if (!grow())
+				{
+					return 0;
+				}
+			}
+			last_ = top_;
+			top_ += aligned;
+			used_ += aligned;
+			return last_;
+		}
+		void* reallocate(void* ptr, size_t old_size, size_t new_size)
+		{
+			size_t old_aligned = alignSize(old_size);
+			size_t new_aligned = alignSize(new_size);
+			if (new_aligned <= old_aligned)
+			{
+				if (ptr == last_)
+				{
+					top_ = last_ + new_aligned;
+					used_ -= old_aligned - new_aligned;
+				}
+				return ptr;
+			}
+			if (ptr == last_ && new_aligned <= size_t(end_ - last_))
+			{//extend in place
+				top_ = last_ + new_aligned;
+				used_ += new_aligned - old_aligned;
+				return ptr;
+			}
+			void* result = allocate(new_size);
+			if (!result)
+			{
+				return 0;
+			}
+			std::memcpy(result, ptr, old_size);
+			return result;
+		}
+		void deallocate(void* ptr, size_t size)
+		{
+			if (ptr == last_)
+			{
+				top_ = last_;
+				last_ = 0;
+				used_ -= alignSize(size);
+			}
+		}
+
+		//! return bytes reserved from system
+		size_t reservedBytes()const
+		{
+			size_t total = 0;
+			for (size_t i = 0; i < chunk_sizes_.size(); ++i)
+			{
+				total += chunk_sizes_[i];
+			}
+			return total;
+		}
+		//! return bytes handed out and not rolled back
+		size_t usedBytes()const { return used_; }
+	private:
+		//non copyable
+		ArenaAllocator(const ArenaAllocator&);
+		ArenaAllocator& operator =(const ArenaAllocator&);
+
+		static size_t alignSize(size_t size)
+		{
+			return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+		}
+		char* newChunk(size_t capacity)
+		{
+			char* chunk = static_cast<char*>(std::malloc(capacity));
+			if (chunk)
+			{
+				chunks_.push_back(chunk);
+				chunk_sizes_.push_back(capacity);
+			}
+			return chunk;
+		}
+		bool grow()
+		{
+			char* chunk = newChunk(chunk_size_);
+			if (!chunk)
+			{
+				return false;
+			}
+			top_ = chunk;
+			end_ = chunk + chunk_size_;
+			last_ = 0;
+			return true;
+		}
+
+		size_t chunk_size_;
+		char* top_;
+		char* end_;
+		char* last_;
+		size_t used_;
+		std::vector<char*> chunks_;
+		std::vector<size_t> chunk_sizes_;
+	};
+
+	//! memory usage of AccountingAllocator
+	struct MemoryStats
+	{
+		static const size_t HISTOGRAM_SIZE = 32;
+
+		MemoryStats() :current_bytes(0), peak_bytes(0), total_allocated_bytes(0), allocation_count(0), deallocation_count(0), reallocation_count(0), failure_count(0)
+		{
+			for (size_t i = 0; i < HISTOGRAM_SIZE; ++i)
+			{
+				size_histogram[i] = 0;
+			}
+		}
+		size_t current_bytes;
+		size_t peak_bytes;
+		//! sum of allocated size and growth by reallocation
+		size_t total_allocated_bytes;
+		size_t allocation_count;
+		size_t deallocation_count;
+		size_t reallocation_count;
+		//! number of allocation rejected by limit or failed in underlying allocator
+		size_t failure_count;
+		//! size_histogram[i] counts requests of size in (2^(i-1),2^i]. last element counts all larger requests
+		size_t size_histogram[HISTOGRAM_SIZE];
+	};
+
+	/**
+	* Allocator decorator that tracks memory usage and enforces hard limit.
+	* Allocation over limit fails, and Lua raises "not enough memory" error.(status is LUA_ERRMEM)
+	* @code
+	* kaguya::standard::shared_ptr<kaguya::AccountingAllocator<> > allocator(new kaguya::AccountingAllocator<>());
+	* kaguya::State state(allocator);
+	* allocator->setLimit(allocator->stats().current_bytes + 4 * 1024 * 1024);
+	* @endcode
+	*/
+	template<typename Allocator = DefaultAllocator>
+	class AccountingAllocator
+	{
+	public:
+		/**
+		* @param limit limit of current bytes. 0 is unlimited
+		* @param base underlying allocator
+		*/
+		explicit AccountingAllocator(size_t limit = 0, standard::shared_ptr<Allocator> base = standard::shared_ptr<Allocator>(new Allocator()))
+			:base_(base), limit_(limit)
+		{
+		}
+
+		void* allocate(size_t size)
+		{
+			if (overLimit(size))
+			{
+				stats_.failure_count++;
+				return 0;
+			}
+			void* result = base_->allocate(size);
+			if (!result)
+			{
+				stats_.failure_count++;
+				return 0;
+			}
+			stats_.allocation_count++;
+			stats_.size_histogram[sizeBucket(size)]++;
+			stats_.total_allocated_bytes += size;
+			increase(size);
+			return result;
+		}
+		void* reallocate(void* ptr, size_t old_size, size_t new_size)
+		{
+			if (new_size > old_size && overLimit(new_size - old_size))
+			{
+				stats_.failure_count++;
+				return 0;
+			}
+			void* result = base_->reallocate(ptr, old_size, new_size);
+			if (!result)
+			{
+				stats_.failure_count++;
+				return 0;
+			}
+			stats_.reallocation_count++;
+			stats_.size_histogram[sizeBucket(new_size)]++;
+			if (new_size > old_size)
+			{
+				stats_.total_allocated_bytes += new_size - old_size;
+			}
+			stats_.current_bytes -= old_size;
+			increase(new_size);
+			return result;
+		}
+		void deallocate(void* ptr, size_t size)
+		{
+			base_->deallocate(ptr, size);
+			stats_.deallocation_count++;
+			stats_.current_bytes -= size;
+		}
+
+		//! set limit of current bytes. 0 is unlimited
+		void setLimit(size_t limit) { limit_ = limit; }
+		size_t limit()const { return limit_; }
+		const MemoryStats& stats()const { return stats_; }
+		//! reset counters and histogram. current bytes is kept, peak bytes is set to current bytes
+		void resetStats()
+		{
+			size_t current = stats_.current_bytes;
+			stats_ = MemoryStats();
+			stats_.current_bytes = current;
+			stats_.peak_bytes = current;
+		}
+		Allocator& base() { return *base_; }
+	private:
+		//non copyable
+		AccountingAllocator(const AccountingAllocator&);
+		AccountingAllocator& operator =(const AccountingAllocator&);
+
+		bool overLimit(size_t increase_size)const
+		{
+			return limit_ != 0 && (increase_size > limit_ || stats_.current_bytes > limit_ - increase_size);
+		}
+		void increase(size_t size)
+		{
+			stats_.current_bytes += size;
+			if (stats_.peak_bytes < stats_.current_bytes)
+			{
+				stats_.peak_bytes = stats_.current_bytes;
+			}
+		}
+		static size_t sizeBucket(size_t size)
+		{
+			size_t bucket = 0;
+			size_t capacity = 1;
+			while (capacity < size && bucket + 1 < MemoryStats::HISTOGRAM_SIZE)
+			{
+				capacity <<= 1;
+				++bucket;
+			}
+			return bucket;
+		}
+
+		standard::shared_ptr<Allocator> base_;
+		size_t limit_;
+		MemoryStats stats_;
+	};
+}
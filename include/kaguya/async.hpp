@@ -0,0 +1,372 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "kaguya/config.hpp"
+#include "kaguya/native_function.hpp"
+#include "kaguya/scheduler.hpp"
+
+#if KAGUYA_USE_CPP11
+#include <mutex>
+#include <future>
+#include <chrono>
+#include <thread>
+#endif
+
+namespace kaguya
+{
+	namespace async_detail
+	{
+#if KAGUYA_USE_CPP11
+		typedef std::mutex mutex_type;
+		typedef std::lock_guard<std::mutex> lock_type;
+#else
+		struct mutex_type {};
+		struct lock_type { lock_type(mutex_type&) {} };
+#endif
+
+		//shared state of AsyncResult
+		template<typename T>
+		struct ResultState :AsyncOperation
+		{
+			ResultState() :done(false), failed(false), value() {}
+			virtual bool ready()
+			{
+				lock_type lock(mutex);
+				return done;
+			}
+			virtual int pushResult(lua_State* thread)
+			{
+				lock_type lock(mutex);
+				if (failed)
+				{
+					lua_pushnil(thread);
+					lua_pushlstring(thread, error.c_str(), error.size());
+					return 2;
+				}
+				return types::push_dispatch(thread, static_cast<const T&>(value));//push copy
+			}
+			mutex_type mutex;
+			bool done;
+			bool failed;
+			T value;
+			std::string error;
+		};
+		template<>
+		struct ResultState<void> :AsyncOperation
+		{
+			ResultState() :done(false), failed(false) {}
+			virtual bool ready()
+			{
+				lock_type lock(mutex);
+				return done;
+			}
+			virtual int pushResult(lua_State* thread)
+			{
+				lock_type lock(mutex);
+				if (failed)
+				{
+					lua_pushnil(thread);
+					lua_pushlstring(thread, error.c_str(), error.size());
+					return 2;
+				}
+				return 0;
+			}
+			mutex_type mutex;
+			bool done;
+			bool failed;
+			std::string error;
+		};
+	}
+
+	/**
+	* Completion handle passed to callback style async function.
+	* Call set() or fail() once when operation is finished.
+	* If KAGUYA_USE_CPP11, it can be completed from other thread.
+	*/
+	template<typename T>
+	class AsyncResult
+	{
+	public:
+		AsyncResult() :state_(new async_detail::ResultState<T>()) {}
+
+		//! complete with value. coroutine is resumed with value.
+		void set(const T& value)
+		{
+			async_detail::lock_type lock(state_->mutex);
+			state_->value = value;
+			state_->done = true;
+		}
+		//! complete with error. coroutine is resumed with nil,message.
+		void fail(const std::string& message)
+		{
+			async_detail::lock_type lock(state_->mutex);
+			state_->error = message;
+			state_->failed = true;
+			state_->done = true;
+		}
+		standard::shared_ptr<AsyncOperation> operation()const { return state_; }
+	private:
+		standard::shared_ptr<async_detail::ResultState<T> > state_;
+	};
+	template<>
+	class AsyncResult<void>
+	{
+	public:
+		AsyncResult() :state_(new async_detail::ResultState<void>()) {}
+
+		//! complete. coroutine is resumed without value.
+		void set()
+		{
+			async_detail::lock_type lock(state_->mutex);
+			state_->done = true;
+		}
+		//! complete with error. coroutine is resumed with nil,message.
+		void fail(const std::string& message)
+		{
+			async_detail::lock_type lock(state_->mutex);
+			state_->error = message;
+			state_->failed = true;
+			state_->done = true;
+		}
+		standard::shared_ptr<AsyncOperation> operation()const { return state_; }
+	private:
+		standard::shared_ptr<async_detail::ResultState<void> > state_;
+	};
+
+	namespace async_detail
+	{
+		struct AsyncFunctionBase
+		{
+			//! start operation. called on scheduler thread.
+			virtual standard::shared_ptr<AsyncOperation> start(VariadicArgType args) = 0;
+			virtual ~AsyncFunctionBase() {}
+		};
+		typedef standard::shared_ptr<AsyncFunctionBase> AsyncFunctionHolder;
+
+		template<typename T>
+		struct CallbackFunction :AsyncFunctionBase
+		{
+			typedef standard::function<void(VariadicArgType, AsyncResult<T>)> func_type;
+			func_type func_;
+			CallbackFunction(func_type fun) :func_(fun) {}
+			virtual standard::shared_ptr<AsyncOperation> start(VariadicArgType args)
+			{
+				AsyncResult<T> result;
+				func_(args, result);
+				return result.operation();
+			}
+		};
+
+#if KAGUYA_USE_CPP11
+		template<typename T>
+		struct FutureOperation :AsyncOperation
+		{
+			std::future<T> future_;
+			FutureOperation(std::future<T>&& f) :future_(std::move(f)) {}
+			virtual bool ready()
+			{
+				return future_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+			}
+			virtual int pushResult(lua_State* thread)
+			{
+				try
+				{
+					T value = future_.get();
+					return types::push_dispatch(thread, static_cast<const T&>(value));//push copy
+				}
+				catch (std::exception& e)
+				{
+					lua_pushnil(thread);
+					lua_pushstring(thread, e.what());
+					return 2;
+				}
+				catch (...)
+				{
+					lua_pushnil(thread);
+					lua_pushstring(thread, "Unknown exception");
+					return 2;
+				}
+			}
+		};
+		template<>
+		struct FutureOperation<void> :AsyncOperation
+		{
+			std::future<void> future_;
+			FutureOperation(std::future<void>&& f) :future_(std::move(f)) {}
+			virtual bool ready()
+			{
+				return future_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+			}
+			virtual int pushResult(lua_State* thread)
+			{
+				try
+				{
+					future_.get();
+					return 0;
+				}
+				catch (std::exception& e)
+				{
+					lua_pushnil(thread);
+					lua_pushstring(thread, e.what());
+					return 2;
+				}
+				catch (...)
+				{
+					lua_pushnil(thread);
+					lua_pushstring(thread, "Unknown exception");
+					return 2;
+				}
+			}
+		};
+
+		template<typename T>
+		struct FutureFunction :AsyncFunctionBase
+		{
+			typedef standard::function<std::future<T>(VariadicArgType)> func_type;
+			func_type func_;
+			FutureFunction(func_type fun) :func_(fun) {}
+			virtual standard::shared_ptr<AsyncOperation> start(VariadicArgType args)
+			{
+				return standard::make_shared<FutureOperation<T> >(func_(args));
+			}
+		};
+#endif
+
+		inline int holder_destructor(lua_State* l)
+		{
+			AsyncFunctionHolder* holder = class_userdata::test_userdata<AsyncFunctionHolder>(l, 1);
+			if (holder)
+			{
+				holder->~AsyncFunctionHolder();
+			}
+			return 0;
+		}
+
+		//lua_CFunction for async function. upvalue 1:scheduler 2:AsyncFunctionHolder
+		inline int async_dispatcher(lua_State* l)
+		{
+			{//C++ objects must be destroyed before lua_error or lua_yield
+				CoroutineScheduler* scheduler = static_cast<CoroutineScheduler*>(lua_touserdata(l, lua_upvalueindex(1)));
+				AsyncFunctionHolder* holder = static_cast<AsyncFunctionHolder*>(lua_touserdata(l, lua_upvalueindex(2)));
+				if (!scheduler->isRunningTask(l))
+				{
+					util::traceBack(l, "async function must be called from scheduled task");
+					return lua_error(l);
+				}
+				bool error = false;
+				try
+				{
+					std::vector<LuaRef> args;
+					int top = lua_gettop(l);
+					args.reserve(top);
+					for (int i = 1; i <= top; ++i)
+					{
+						args.push_back(types::get(l, i, types::typetag<LuaRef>()));
+					}
+					scheduler->suspend(l, (*holder)->start(args));
+				}
+				catch (std::exception & e)
+				{
+					util::traceBack(l, e.what());
+					error = true;
+				}
+				catch (...)
+				{
+					util::traceBack(l, "Unknown exception");
+					error = true;
+				}
+				if (error)
+				{
+					return lua_error(l);
+				}
+			}
+			return lua_yield(l, 0);
+		}
+
+		inline LuaFunction push_async_function(CoroutineScheduler& scheduler, const AsyncFunctionHolder& fun)
+		{
+			lua_State* l = scheduler.state();
+			util::ScopedSavedStack save(l);
+			lua_pushlightuserdata(l, &scheduler);
+			void* storage = lua_newuserdata(l, sizeof(AsyncFunctionHolder));
+			new(storage) AsyncFunctionHolder(fun);
+			if (class_userdata::newmetatable<AsyncFunctionHolder>(l))
+			{
+				lua_pushcclosure(l, &holder_destructor, 0);
+				lua_setfield(l, -2, "__gc");
+			}
+			lua_setmetatable(l, -2);
+			lua_pushcclosure(l, &async_dispatcher, 2);
+			return LuaFunction(l, StackTop());
+		}
+	}
+
+	/**
+	* @brief create Lua function that suspends calling coroutine until AsyncResult is completed.
+	* @code
+	* state["fetch"] = kaguya::async_callback<std::string>(scheduler, fetch);
+	* //void fetch(kaguya::VariadicArgType args, kaguya::AsyncResult<std::string> result)
+	* @endcode
+	* Lua side receives value, or nil and error message on fail.
+	* Function must be called from task of scheduler.
+	*/
+	template<typename T>
+	inline LuaFunction async_callback(CoroutineScheduler& scheduler, standard::function<void(VariadicArgType, AsyncResult<T>)> f)
+	{
+		return async_detail::push_async_function(scheduler, async_detail::AsyncFunctionHolder(new async_detail::CallbackFunction<T>(f)));
+	}
+
+#if KAGUYA_USE_CPP11
+	/**
+	* @brief create Lua function that suspends calling coroutine until returned std::future is ready.
+	* @code
+	* state["read"] = kaguya::async_future(scheduler, [](kaguya::VariadicArgType args) {
+	*   return std::async(std::launch::async, read_file, args[0].get<std::string>());
+	* });
+	* @endcode
+	* Lua side receives value, or nil and exception message.
+	*/
+	template<typename F>
+	inline LuaFunction async_future(CoroutineScheduler& scheduler, F f)
+	{
+		typedef decltype(f(std::declval<std::vector<LuaRef> >()).get()) result_type;
+		return async_detail::push_async_function(scheduler,
+			async_detail::AsyncFunctionHolder(new async_detail::FutureFunction<result_type>(f)));
+	}
+
+	/**
+	* @brief run scheduler until all tasks are finished.
+	* Time is seconds of std::chrono::steady_clock.
+	* @param poll_interval sleep time in seconds while tasks are waiting for async operations
+	*/
+	inline void run_event_loop(CoroutineScheduler& scheduler, double poll_interval = 0.001)
+	{
+		typedef std::chrono::steady_clock clock_type;
+		while (!scheduler.empty())
+		{
+			double now = std::chrono::duration<double>(clock_type::now().time_since_epoch()).count();
+			scheduler.update(now);
+			if (scheduler.hasReadyTask() || scheduler.empty())
+			{
+				continue;
+			}
+			double wait = poll_interval;
+			if (!scheduler.hasPendingOperation())
+			{
+				double wake = scheduler.nextWakeTime();
+				if (wake < 0)
+				{
+					break;//waiting event only.can not progress
+				}
+				wait = wake - now;
+			}
+			if (wait > 0)
+			{
+				std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+			}
+		}
+	}
+#endif
+}
@@ -0,0 +1,326 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "kaguya/config.hpp"
+#include "kaguya/mapped_file.hpp"
+#include "kaguya/state.hpp"
+
+namespace kaguya
+{
+	namespace bytecode_detail
+	{
+		typedef unsigned long long hash_type;
+
+		//! FNV-1a 64bit hash
+		inline hash_type fnv1a(const char* data, size_t size)
+		{
+			hash_type hash = 14695981039346656037ULL;
+			for (size_t i = 0; i < size; ++i)
+			{
+				hash ^= static_cast<unsigned char>(data[i]);
+				hash *= 1099511628211ULL;
+			}
+			return hash;
+		}
+		inline hash_type fnv1a(const std::string& data)
+		{
+			return fnv1a(data.data(), data.size());
+		}
+
+		struct FileStat
+		{
+			FileStat() :mtime(0), size(0) {}
+			long long mtime;
+			unsigned long long size;
+		};
+		inline bool fileStat(const char* path, FileStat& out)
+		{
+			struct stat st;
+			if (::stat(path, &st) != 0)
+			{
+				return false;
+			}
+			out.mtime = static_cast<long long>(st.st_mtime);
+			out.size = static_cast<unsigned long long>(st.st_size);
+			return true;
+		}
+		inline int string_writer(lua_State*, const void* p, size_t size, void* ud)
+		{
+			static_cast<std::string*>(ud)->append(static_cast<const char*>(p), size);
+			return 0;
+		}
+
+		//! header of on disk cache file. followed by source path and bytecode
+		struct DiskHeader
+		{
+			char magic[8];
+			long long mtime;
+			unsigned long long size;
+			hash_type hash;
+			int lua_version;
+			int strip;
+			unsigned int path_length;
+		};
+		static const char DISK_MAGIC[8] = { 'K', 'G', 'Y', 'L', 'U', 'A', 'C', '1' };
+	}
+
+	/**
+	* Compiled bytecode cache for loadfile and dofile.
+	* Cache entry is keyed by file path and validated by modification time and size of the file.
+	* If verify hash option is enabled, content hash of the source is also validated.
+	* (modification time has coarse resolution on some file systems)
+	* Entries are kept in memory, and stored to cache directory if directory is given.
+	* Not thread safe. Share one instance only between States used from the same thread.
+	* @code
+	* kaguya::standard::shared_ptr<kaguya::BytecodeCache> cache(new kaguya::BytecodeCache("/var/cache/scripts"));
+	* state.setFileLoader(cache);
+	* state.dofile("main.lua");
+	* @endcode
+	*/
+	class BytecodeCache : public FileLoader
+	{
+	public:
+		/**
+		* @param cache_directory directory for on disk cache. empty is memory only.
+		*/
+		explicit BytecodeCache(const std::string& cache_directory = std::string())
+			:directory_(cache_directory), strip_(false), verify_hash_(false), hit_count_(0), miss_count_(0)
+		{
+		}
+
+		/**
+		* @brief strip debug information from cached bytecode.(Lua5.3 or later)
+		* Stripped chunk has no line numbers in error message.
+		*/
+		void setStripDebugInfo(bool strip) { strip_ = strip; }
+		bool stripDebugInfo()const { return strip_; }
+
+		//! validate content hash of source file on each load
+		void setVerifyHash(bool verify) { verify_hash_ = verify; }
+		bool verifyHash()const { return verify_hash_; }
+
+		/**
+		* @brief load file as Lua function and push to stack.
+		* @param state lua state
+		* @param path file path of lua script
+		* @return status code of lua_load. On error, error message is pushed instead of function.
+		*/
+		virtual int load(lua_State* state, const char* path)
+		{
+			bytecode_detail::FileStat stat;
+			if (!bytecode_detail::fileStat(path, stat))
+			{
+				return luaL_loadfile(state, path);
+			}
+			bytecode_detail::hash_type hash = 0;
+			if (verify_hash_)
+			{
+				util::MappedFile source(path);
+				hash = source.isOpen() ? bytecode_detail::fnv1a(source.data(), source.size()) : bytecode_detail::fnv1a("", 0);
+			}
+			std::string chunkname = std::string("@") + path;
+
+			Entry& entry = entries_[path];
+			if (isValid(entry, stat, hash) || (!directory_.empty() && readDiskEntry(path, stat, hash, entry)))
+			{
+				if (loadBytecode(state, entry.bytecode, chunkname) == 0)
+				{
+					hit_count_++;
+					return 0;
+				}
+				lua_pop(state, 1);//incompatible bytecode. recompile
+			}
+
+			miss_count_++;
+			int status = util::loadMappedFile(state, path);
+			if (status)
+			{
+				entries_.erase(path);
+				return status;
+			}
+			entry.valid = true;
+			entry.stat = stat;
+			entry.hash = hash;
+			entry.strip = strip_;
+			entry.bytecode.clear();
+			dump(state, entry.bytecode);
+			if (!directory_.empty())
+			{
+				writeDiskEntry(path, entry);
+			}
+			return 0;
+		}
+
+		//! remove all entries in memory. on disk cache files are kept.
+		void clear() { entries_.clear(); }
+		//! remove memory and on disk entry of path
+		void erase(const std::string& path)
+		{
+			entries_.erase(path);
+			if (!directory_.empty())
+			{
+				std::remove(cacheFilePath(path).c_str());
+			}
+		}
+		//! return number of entries in memory
+		size_t size()const { return entries_.size(); }
+		size_t hitCount()const { return hit_count_; }
+		size_t missCount()const { return miss_count_; }
+
+		//! return on disk cache file path for source path
+		std::string cacheFilePath(const std::string& path)const
+		{
+			char name[32] = { 0 };
+			std::sprintf(name, "%016llx.luac", bytecode_detail::fnv1a(path));
+			if (directory_.empty())
+			{
+				return name;
+			}
+			char last = directory_[directory_.size() - 1];
+			if (last == '/' || last == '\\')
+			{
+				return directory_ + name;
+			}
+			return directory_ + "/" + name;
+		}
+	private:
+		//non copyable
+		BytecodeCache(const BytecodeCache&);
+		BytecodeCache& operator =(const BytecodeCache&);
+
+		struct Entry
+		{
+			Entry() :valid(false), hash(0), strip(false) {}
+			bool valid;
+			bytecode_detail::FileStat stat;
+			bytecode_detail::hash_type hash;
+			bool strip;
+			std::string bytecode;
+		};
+
+		bool isValid(const Entry& entry, const bytecode_detail::FileStat& stat, bytecode_detail::hash_type hash)const
+		{
+			return entry.valid
+				&& entry.stat.mtime == stat.mtime
+				&& entry.stat.size == stat.size
+				&& entry.strip == strip_
+				&& (!verify_hash_ || entry.hash == hash);
+		}
+
+		static int loadBytecode(lua_State* state, const std::string& bytecode, const std::string& chunkname)
+		{
+			return util::loadBuffer(state, bytecode.data(), bytecode.size(), chunkname.c_str(), "b");
+		}
+		void dump(lua_State* state, std::string& out)const
+		{
+#if LUA_VERSION_NUM >= 503
+			lua_dump(state, &bytecode_detail::string_writer, &out, strip_ ? 1 : 0);
+#else
+			lua_dump(state, &bytecode_detail::string_writer, &out);
+#endif
+		}
+
+		bool readDiskEntry(const std::string& path, const bytecode_detail::FileStat& stat, bytecode_detail::hash_type hash, Entry& entry)
+		{
+			util::MappedFile file(cacheFilePath(path).c_str());
+			if (!file.isOpen() || file.size() < sizeof(bytecode_detail::DiskHeader))
+			{
+				return false;
+			}
+			bytecode_detail::DiskHeader header;
+			std::memcpy(&header, file.data(), sizeof(header));
+			size_t offset = sizeof(header) + header.path_length;
+			if (std::memcmp(header.magic, bytecode_detail::DISK_MAGIC, sizeof(header.magic)) != 0
+				|| header.lua_version != LUA_VERSION_NUM
+				|| file.size() < offset
+				|| path.compare(0, std::string::npos, file.data() + sizeof(header), header.path_length) != 0)
+			{
+				return false;
+			}
+			Entry disk_entry;
+			disk_entry.valid = true;
+			disk_entry.stat.mtime = header.mtime;
+			disk_entry.stat.size = header.size;
+			disk_entry.hash = header.hash;
+			disk_entry.strip = header.strip != 0;
+			if (!isValid(disk_entry, stat, hash))
+			{
+				return false;
+			}
+			entry = disk_entry;
+			entry.bytecode.assign(file.data() + offset, file.size() - offset);
+			return true;
+		}
+		//! unique per process and cache object. writers must not share temporary file
+		std::string tempSuffix()const
+		{
+#ifdef _WIN32
+			unsigned long pid = static_cast<unsigned long>(_getpid());
+#else
+			unsigned long pid = static_cast<unsigned long>(getpid());
+#endif
+			std::ostringstream suffix;
+			suffix << '.' << pid << '.' << static_cast<const void*>(this) << ".tmp";
+			return suffix.str();
+		}
+		void writeDiskEntry(const std::string& path, const Entry& entry)const
+		{
+			bytecode_detail::DiskHeader header;
+			std::memset(&header, 0, sizeof(header));
+			std::memcpy(header.magic, bytecode_detail::DISK_MAGIC, sizeof(header.magic));
+			header.mtime = entry.stat.mtime;
+			header.size = entry.stat.size;
+			header.hash = entry.hash;
+			header.lua_version = LUA_VERSION_NUM;
+			header.strip = entry.strip ? 1 : 0;
+			header.path_length = static_cast<unsigned int>(path.size());
+
+			//write to temporary file and rename. other process never reads partially written file
+			std::string cache_path = cacheFilePath(path);
+			std::string temp_path = cache_path + tempSuffix();
+			{
+				std::ofstream ofs(temp_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+				if (!ofs)
+				{
+					return;
+				}
+				ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+				ofs.write(path.data(), path.size());
+				ofs.write(entry.bytecode.data(), entry.bytecode.size());
+				if (!ofs)
+				{
+					ofs.close();
+					std::remove(temp_path.c_str());
+					return;
+				}
+			}
+#ifdef _WIN32
+			std::remove(cache_path.c_str());
+#endif
+			if (std::rename(temp_path.c_str(), cache_path.c_str()) != 0)
+			{
+				std::remove(temp_path.c_str());
+			}
+		}
+
+		std::string directory_;
+		bool strip_;
+		bool verify_hash_;
+		size_t hit_count_;
+		size_t miss_count_;
+		std::map<std::string, Entry> entries_;
+	};
+}
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <cstring>
+
+#include "kaguya/state.hpp"
+#include "kaguya/lua_ref_function.hpp"
+#include "kaguya/bytecode_cache.hpp"
+#include "kaguya/mapped_file.hpp"
+
+#if KAGUYA_USE_CPP11
+#include <mutex>
+#endif
+
+namespace kaguya
+{
+	namespace chunk_detail
+	{
+#if KAGUYA_USE_CPP11
+		typedef std::mutex mutex_type;
+		typedef std::lock_guard<std::mutex> lock_type;
+#else
+		struct mutex_type {};
+		struct lock_type { lock_type(mutex_type&) {} };
+#endif
+		//FNV-1a
+		inline size_t hash(const char* data, size_t size)
+		{
+			size_t h = 2166136261u;
+			for (size_t i = 0; i < size; ++i)
+			{
+				h = (h ^ static_cast<unsigned char>(data[i])) * 16777619u;
+			}
+			return h;
+		}
+		inline bool equal(const std::string& str, const char* data, size_t size)
+		{
+			return str.size() == size && std::memcmp(str.data(), data, size) == 0;
+		}
+	}
+
+	/**
+	* Process wide registry of compiled chunks.
+	* Each source is compiled once, and any State creates function from shared bytecode.
+	* Thread safe if KAGUYA_USE_CPP11. Compilation runs outside of lock on the calling State.
+	* String entries are keyed by hash of the source and hold the only copy of it.
+	* At most maxSourceEntries() strings are kept; when full, an arbitrary string entry is dropped.
+	* File entries are not limited. Use erase() or clear() to release them.
+	* @code
+	* //on each worker thread
+	* kaguya::LuaFunction main = kaguya::ChunkRegistry::instance().loadfile(state.state(), "main.lua");
+	* @endcode
+	*/
+	class ChunkRegistry
+	{
+	public:
+		static ChunkRegistry& instance()
+		{
+			static ChunkRegistry registry;
+			return registry;
+		}
+
+		/**
+		* @brief load source as Lua function and push to stack.
+		* @param state lua state
+		* @param source lua code
+		* @param size size of source
+		* @param chunkname chunk name for debug information
+		* @return status code of lua_load. On error, error message is pushed instead of function.
+		*/
+		int loadToStack(lua_State* state, const char* source, size_t size, const char* chunkname)
+		{
+			size_t key = chunk_detail::hash(source, size);
+			//loadstring use source as chunkname. keep it only once
+			bool named_by_source = std::strlen(chunkname) == size && std::memcmp(chunkname, source, size) == 0;
+			standard::shared_ptr<const Chunk> chunk = findSource(key);
+			if (chunk && chunk_detail::equal(chunk->source, source, size)
+				&& chunk->named_by_source == named_by_source && (named_by_source || chunk->name == chunkname))
+			{
+				return util::loadBuffer(state, chunk->bytecode.data(), chunk->bytecode.size(), chunkname, "b");
+			}
+			int status = luaL_loadbuffer(state, source, size, chunkname);
+			if (status)
+			{
+				return status;
+			}
+			standard::shared_ptr<Chunk> compiled = compile(state, bytecode_detail::FileStat());
+			compiled->source.assign(source, size);
+			compiled->named_by_source = named_by_source;
+			if (!named_by_source)
+			{
+				compiled->name = chunkname;
+			}
+			insertSource(key, compiled);
+			return 0;
+		}
+
+		/**
+		* @brief load file as Lua function and push to stack.
+		* File entry is recompiled when modification time or size of the file is changed.
+		* @param state lua state
+		* @param path file path of lua script
+		* @return status code of lua_load. On error, error message is pushed instead of function.
+		*/
+		int loadfileToStack(lua_State* state, const char* path)
+		{
+			bytecode_detail::FileStat stat;
+			if (!bytecode_detail::fileStat(path, stat))
+			{
+				return luaL_loadfile(state, path);
+			}
+			std::string key = std::string("@") + path;
+			standard::shared_ptr<const Chunk> chunk = find(key);
+			if (chunk && chunk->stat.mtime == stat.mtime && chunk->stat.size == stat.size)
+			{
+				return util::loadBuffer(state, chunk->bytecode.data(), chunk->bytecode.size(), key.c_str(), "b");
+			}
+			int status = util::loadMappedFile(state, path);
+			if (status)
+			{
+				return status;
+			}
+			insert(key, compile(state, stat));
+			return 0;
+		}
+
+		/**
+		* @name loadstring
+		* @brief If there are no errors,return compiled chunk as a Lua function.
+		*  Otherwise send error message to error handler and return nil reference
+		*/
+		//@{
+		LuaFunction loadstring(lua_State* state, const std::string& luacode)
+		{
+			util::ScopedSavedStack save(state);
+			return result(state, loadToStack(state, luacode.data(), luacode.size(), luacode.c_str()));
+		}
+		LuaFunction loadstring(lua_State* state, const char* luacode)
+		{
+			util::ScopedSavedStack save(state);
+			return result(state, loadToStack(state, luacode, std::strlen(luacode), luacode));
+		}
+		//@}
+
+		/**
+		* @name loadfile
+		* @brief If there are no errors,return compiled file as a Lua function.
+		*  Otherwise send error message to error handler and return nil reference
+		*/
+		//@{
+		LuaFunction loadfile(lua_State* state, const std::string& file)
+		{
+			return loadfile(state, file.c_str());
+		}
+		LuaFunction loadfile(lua_State* state, const char* file)
+		{
+			util::ScopedSavedStack save(state);
+			return result(state, loadfileToStack(state, file));
+		}
+		//@}
+
+		//! remove entry of file
+		void erase(const std::string& path)
+		{
+			chunk_detail::lock_type lock(mutex_);
+			chunks_.erase("@" + path);
+		}
+		//! remove all entries
+		void clear()
+		{
+			chunk_detail::lock_type lock(mutex_);
+			chunks_.clear();
+			sources_.clear();
+		}
+		//! return number of entries
+		size_t size()
+		{
+			chunk_detail::lock_type lock(mutex_);
+			return chunks_.size() + sources_.size();
+		}
+		//! set maximum number of string entries. 0 is unlimited
+		void setMaxSourceEntries(size_t count)
+		{
+			chunk_detail::lock_type lock(mutex_);
+			max_sources_ = count;
+			while (max_sources_ && sources_.size() > max_sources_)
+			{
+				sources_.erase(sources_.begin());
+			}
+		}
+		//! return maximum number of string entries
+		size_t maxSourceEntries()
+		{
+			chunk_detail::lock_type lock(mutex_);
+			return max_sources_;
+		}
+	private:
+		ChunkRegistry() :max_sources_(1024) {}
+		//non copyable
+		ChunkRegistry(const ChunkRegistry&);
+		ChunkRegistry& operator =(const ChunkRegistry&);
+
+		struct Chunk
+		{
+			Chunk() :named_by_source(false) {}
+			bytecode_detail::FileStat stat;
+			std::string bytecode;
+			std::string source;//empty for file entry
+			std::string name;//empty if chunk name is the source
+			bool named_by_source;
+		};
+		typedef standard::shared_ptr<const Chunk> ChunkPtr;
+
+		static LuaFunction result(lua_State* state, int status)
+		{
+			if (status)
+			{
+				ErrorHandler::instance().handle(status, state);
+				return LuaRef(state);
+			}
+			return LuaFunction(state, StackTop());
+		}
+		//dump function at stack top
+		static standard::shared_ptr<Chunk> compile(lua_State* state, const bytecode_detail::FileStat& stat)
+		{
+			standard::shared_ptr<Chunk> chunk(new Chunk());
+			chunk->stat = stat;
+#if LUA_VERSION_NUM >= 503
+			lua_dump(state, &bytecode_detail::string_writer, &chunk->bytecode, 0);
+#else
+			lua_dump(state, &bytecode_detail::string_writer, &chunk->bytecode);
+#endif
+			return chunk;
+		}
+		ChunkPtr find(const std::string& key)
+		{
+			chunk_detail::lock_type lock(mutex_);
+			std::map<std::string, ChunkPtr>::const_iterator it = chunks_.find(key);
+			return it != chunks_.end() ? it->second : ChunkPtr();
+		}
+		void insert(const std::string& key, const ChunkPtr& chunk)
+		{
+			chunk_detail::lock_type lock(mutex_);
+			chunks_[key] = chunk;
+		}
+		ChunkPtr findSource(size_t key)
+		{
+			chunk_detail::lock_type lock(mutex_);
+			std::map<size_t, ChunkPtr>::const_iterator it = sources_.find(key);
+			return it != sources_.end() ? it->second : ChunkPtr();
+		}
+		//hash collision replaces previous entry
+		void insertSource(size_t key, const ChunkPtr& chunk)
+		{
+			chunk_detail::lock_type lock(mutex_);
+			if (max_sources_ && sources_.size() >= max_sources_ && sources_.find(key) == sources_.end())
+			{
+				sources_.erase(sources_.begin());
+			}
+			sources_[key] = chunk;
+		}
+
+		chunk_detail::mutex_type mutex_;
+		std::map<std::string, ChunkPtr> chunks_;
+		std::map<size_t, ChunkPtr> sources_;
+		size_t max_sources_;
+	};
+}
@@ -64,6 +64,46 @@ extern "C" {
 #endif
 #endif
 
+//! record call counts and latency of functions registered by ClassMetatable. see kaguya/instrumentation.hpp
+#ifndef KAGUYA_ENABLE_INSTRUMENTATION
+#define KAGUYA_ENABLE_INSTRUMENTATION 0
+#endif
+
+//! cache error handler of each lua_State in lua_getextraspace (Lua 5.3 or later, if LUA_EXTRASPACE holds a pointer).
+//! the cache is written when kaguya::State is constructed on the lua_State, so every lua_State passed to kaguya
+//! must be wrapped by kaguya::State before coroutines are created from it. define 0 if other code uses the extra space.
+#ifndef KAGUYA_ERROR_HANDLER_USE_EXTRASPACE
+#define KAGUYA_ERROR_HANDLER_USE_EXTRASPACE 1
+#endif
+#if KAGUYA_ERROR_HANDLER_USE_EXTRASPACE && LUA_VERSION_NUM < 503
+#undef KAGUYA_ERROR_HANDLER_USE_EXTRASPACE
+#define KAGUYA_ERROR_HANDLER_USE_EXTRASPACE 0
+#endif
+
+//! compile non-template code once in src/kaguya.cpp instead of in every translation unit. link kaguya library
+#ifndef KAGUYA_SEPARATE_COMPILATION
+#define KAGUYA_SEPARATE_COMPILATION 0
+#endif
+
+#if KAGUYA_SEPARATE_COMPILATION
+//! defined only in src/kaguya.cpp
+#ifdef KAGUYA_SOURCE
+#define KAGUYA_EXTERN_TEMPLATE template
+#else
+#define KAGUYA_EXTERN_TEMPLATE extern template
+#endif
+#define KAGUYA_DECL
+#else
+#define KAGUYA_DECL inline
+#endif
+
+//! 1 if definitions in kaguya/impl/*.inl are compiled in this translation unit
+#if !KAGUYA_SEPARATE_COMPILATION || defined(KAGUYA_SOURCE)
+#define KAGUYA_COMPILE_IMPL 1
+#else
+#define KAGUYA_COMPILE_IMPL 0
+#endif
+
 
 namespace kaguya
 {
@@ -88,6 +128,9 @@ namespace kaguya
 
 	//compatibility for Lua5.1
 #if LUA_VERSION_NUM < 502
+	inline int lua_absindex(lua_State *L, int idx) {
+		return (idx > 0 || idx <= LUA_REGISTRYINDEX) ? idx : lua_gettop(L) + idx + 1;
+	}
 	inline void luaL_setmetatable(lua_State *L, const char *tname) {
 		luaL_getmetatable(L, tname);
 		lua_setmetatable(L, -2);
@@ -25,16 +25,17 @@ namespace kaguya
 		LuaTypeMismatch(const char* what)throw() :LuaException(0, what) {}
 		LuaTypeMismatch(const std::string& what) :LuaException(0, what) {}
 	};
+	//! thrown regardless of KAGUYA_ERROR_NO_THROW if Lua state can not be created
+	class LuaMemoryError :public LuaException {
+	public:
+		LuaMemoryError(int status, const char* what)throw() :LuaException(status, what) {}
+	};
 #if !KAGUYA_ERROR_NO_THROW
 	class LuaRuntimeError :public LuaException {
 	public:
 		LuaRuntimeError(int status, const char* what)throw() :LuaException(status, what) {}
 		LuaRuntimeError(int status, const std::string& what) :LuaException(status, what) {}
 	};
-	class LuaMemoryError :public LuaException {
-	public:
-		LuaMemoryError(int status, const char* what)throw() :LuaException(status, what) {}
-	};
 	class LuaRunningError :public LuaException {
 	public:
 		LuaRunningError(int status, const char* what)throw() :LuaException(status, what) {}
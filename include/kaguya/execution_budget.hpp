@@ -0,0 +1,172 @@
+#pragma once
+
+#include <ctime>
+
+#include "kaguya/config.hpp"
+
+#if KAGUYA_USE_CPP11
+#include <chrono>
+#endif
+
+namespace kaguya
+{
+	//! behavior when execution budget is exceeded
+	enum budget_action
+	{
+		BUDGET_ABORT,//!< raise Lua error "execution budget exceeded"
+		BUDGET_YIELD//!< yield running coroutine and start new budget on next resume. abort if not yieldable (Lua5.2 or later)
+	};
+
+	/**
+	* Limit instruction count and execution time of Lua code while this object exists.
+	* Budget is checked by count hook every check_interval instructions. No hook is set when both limits are zero.
+	* Previous hook is restored on destruction.
+	* Coroutines created before construction are not limited.
+	* @code
+	* {
+	*   kaguya::ScopedExecutionBudget budget(state.state(), 1000000, 0.05);//1M instructions, 50ms
+	*   state("run_script()");
+	*   if (budget.exceeded()) { ... }
+	* }
+	* @endcode
+	*/
+	class ScopedExecutionBudget
+	{
+	public:
+		/**
+		* @param state lua state
+		* @param instruction_limit max number of instructions. 0 is unlimited
+		* @param time_limit max seconds. 0 is unlimited
+		* @param action abort or yield when exceeded
+		* @param check_interval instructions between budget checks
+		*/
+		ScopedExecutionBudget(lua_State* state, size_t instruction_limit, double time_limit = 0, budget_action action = BUDGET_ABORT, int check_interval = 1000)
+			:state_(state), prev_hook_(lua_gethook(state)), prev_mask_(lua_gethookmask(state)), prev_count_(lua_gethookcount(state)), prev_budget_(0)
+			, instruction_limit_(instruction_limit), time_limit_(time_limit), action_(action), interval_(check_interval > 0 ? check_interval : 1)
+			, executed_(0), deadline_(0), exceeded_(false), resumed_(false)
+		{
+			if (!active())
+			{
+				return;
+			}
+			if (time_limit_ > 0)
+			{
+				deadline_ = now() + time_limit_;
+			}
+			lua_pushlightuserdata(state_, key());
+			lua_rawget(state_, LUA_REGISTRYINDEX);
+			prev_budget_ = lua_touserdata(state_, -1);
+			lua_pop(state_, 1);
+			setCurrent(this);
+			lua_sethook(state_, &hook, LUA_MASKCOUNT, interval_);
+		}
+		~ScopedExecutionBudget()
+		{
+			if (!active())
+			{
+				return;
+			}
+			setCurrent(prev_budget_);
+			lua_sethook(state_, prev_hook_, prev_mask_, prev_count_);
+		}
+
+		//! return true if budget was exceeded
+		bool exceeded()const { return exceeded_; }
+		//! approximate number of executed instructions. (counted per check interval)
+		size_t executedInstructions()const { return executed_; }
+	private:
+		//non copyable
+		ScopedExecutionBudget(const ScopedExecutionBudget&);
+		ScopedExecutionBudget& operator =(const ScopedExecutionBudget&);
+
+		bool active()const { return instruction_limit_ > 0 || time_limit_ > 0; }
+
+		static void* key()
+		{
+			static char key;
+			return &key;
+		}
+		static double now()
+		{
+#if KAGUYA_USE_CPP11
+			return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+			return double(std::clock()) / CLOCKS_PER_SEC;
+#endif
+		}
+		void setCurrent(void* budget)
+		{
+			lua_pushlightuserdata(state_, key());
+			if (budget)
+			{
+				lua_pushlightuserdata(state_, budget);
+			}
+			else
+			{
+				lua_pushnil(state_);
+			}
+			lua_rawset(state_, LUA_REGISTRYINDEX);
+		}
+
+		static bool yieldable(lua_State* l)
+		{
+#if LUA_VERSION_NUM >= 503
+			return lua_isyieldable(l) != 0;
+#elif LUA_VERSION_NUM >= 502
+			bool main = lua_pushthread(l) == 1;
+			lua_pop(l, 1);
+			return !main;
+#else
+			return false;
+#endif
+		}
+
+		//count hook. C++ objects must not live at luaL_error or lua_yield
+		static void hook(lua_State* l, lua_Debug*)
+		{
+			lua_pushlightuserdata(l, key());
+			lua_rawget(l, LUA_REGISTRYINDEX);
+			ScopedExecutionBudget* self = static_cast<ScopedExecutionBudget*>(lua_touserdata(l, -1));
+			lua_pop(l, 1);
+			if (!self)
+			{
+				return;
+			}
+			if (self->resumed_)
+			{//first check after yield. start new slice
+				self->resumed_ = false;
+				self->executed_ = 0;
+				self->deadline_ = now() + self->time_limit_;
+			}
+			self->executed_ += self->interval_;
+			bool over_count = self->instruction_limit_ > 0 && self->executed_ >= self->instruction_limit_;
+			bool over_time = self->time_limit_ > 0 && now() >= self->deadline_;
+			if (!over_count && !over_time)
+			{
+				return;
+			}
+			self->exceeded_ = true;
+			if (self->action_ == BUDGET_YIELD && yieldable(l))
+			{
+				self->resumed_ = true;
+				lua_yield(l, 0);
+				return;
+			}
+			luaL_error(l, over_count ? "execution budget exceeded (instruction count)" : "execution budget exceeded (time)");
+		}
+
+		lua_State* state_;
+		lua_Hook prev_hook_;
+		int prev_mask_;
+		int prev_count_;
+		void* prev_budget_;
+		size_t instruction_limit_;
+		double time_limit_;
+		budget_action action_;
+		int interval_;
+		size_t executed_;
+		double deadline_;
+		bool exceeded_;
+		bool resumed_;
+	};
+}
@@ -0,0 +1,288 @@
+#pragma once
+
+#include "kaguya/config.hpp"
+
+#if KAGUYA_USE_CPP11
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <atomic>
+
+#include "kaguya/state.hpp"
+#include "kaguya/exception.hpp"
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define KAGUYA_EXECUTOR_THREAD_LOCAL __declspec(thread)
+#else
+#define KAGUYA_EXECUTOR_THREAD_LOCAL thread_local
+#endif
+
+namespace kaguya
+{
+#if KAGUYA_USE_VARIADIC_TEMPLATE
+	namespace executor_detail
+	{
+		template<typename R>
+		struct call_global
+		{
+			template<typename... Args>
+			static R call(State& state, const std::string& name, Args... args)
+			{
+				return state[name](args...).template get<R>();
+			}
+		};
+		template<>
+		struct call_global<void>
+		{
+			template<typename... Args>
+			static void call(State& state, const std::string& name, Args... args)
+			{
+				state[name](args...);
+			}
+		};
+	}
+#endif
+
+	/**
+	* Thread pool that owns one State per worker thread.
+	* Each State is initialized by the same setup function, and jobs run on any worker.
+	* Jobs are queued to per worker deques, and idle worker steals jobs from other workers.
+	* Lua errors are thrown as LuaException and reported through std::future.
+	* (unless setup function replaces error handler)
+	* Globals are not shared between workers. Do not rely on state left by previous job.
+	* @code
+	* kaguya::Executor executor(4, [](kaguya::State& state) { state.dofile("handlers.lua"); });
+	* std::future<int> result = executor.call<int>("handle", 1, "request");
+	* int value = result.get();
+	* @endcode
+	*/
+	class Executor
+	{
+	public:
+		typedef std::function<void(State&)> setup_function_type;
+		typedef std::function<void(State&)> job_type;
+
+		/**
+		* @param thread_count number of worker threads and States. 0 is std::thread::hardware_concurrency()
+		* @param setup function called once for each State, on constructing thread
+		*/
+		explicit Executor(size_t thread_count = 0, setup_function_type setup = setup_function_type())
+			:pending_(0), sleeping_(0), stop_(false), next_(0), stolen_count_(0)
+		{
+			if (thread_count == 0)
+			{
+				thread_count = std::max(1u, std::thread::hardware_concurrency());
+			}
+			workers_.reserve(thread_count);
+			for (size_t i = 0; i < thread_count; ++i)
+			{
+				workers_.push_back(std::unique_ptr<Worker>(new Worker()));
+				State& state = workers_.back()->state;
+				state.setErrorHandler(&throw_error);
+				if (setup)
+				{
+					setup(state);
+				}
+			}
+			for (size_t i = 0; i < workers_.size(); ++i)
+			{
+				workers_[i]->thread = std::thread(&Executor::run, this, i);
+			}
+		}
+		//! wait for all queued jobs and join worker threads
+		~Executor()
+		{
+			{
+				std::lock_guard<std::mutex> lock(sleep_mutex_);
+				stop_ = true;
+			}
+			wakeup_.notify_all();
+			for (size_t i = 0; i < workers_.size(); ++i)
+			{
+				workers_[i]->thread.join();
+			}
+		}
+
+		/**
+		* @brief run function on any worker.
+		* @param f callable with signature R(kaguya::State&)
+		* @return future of result
+		*/
+		template<typename F>
+		std::future<typename std::result_of<F(State&)>::type> submit(F f)
+		{
+			typedef typename std::result_of<F(State&)>::type result_type;
+			std::shared_ptr<std::packaged_task<result_type(State&)> > task =
+				std::make_shared<std::packaged_task<result_type(State&)> >(f);
+			std::future<result_type> result = task->get_future();
+			push([task](State& state) { (*task)(state); });
+			return result;
+		}
+
+#if KAGUYA_USE_VARIADIC_TEMPLATE
+		/**
+		* @brief call global Lua function on any worker.
+		* @param name global function name
+		* @param args arguments. copied to job
+		* @return future of result converted to R
+		*/
+		template<typename R, typename... Args>
+		std::future<R> call(const std::string& name, Args... args)
+		{
+			return submit([=](State& state) -> R
+			{
+				return executor_detail::call_global<R>::call(state, name, args...);
+			});
+		}
+#endif
+
+		//! number of worker threads
+		size_t size()const { return workers_.size(); }
+		//! number of jobs taken from other worker queue
+		size_t stolenCount()const { return stolen_count_; }
+	private:
+		//non copyable
+		Executor(const Executor&);
+		Executor& operator =(const Executor&);
+
+		struct Worker
+		{
+			State state;
+			std::mutex mutex;
+			std::deque<job_type> queue;
+			std::thread thread;
+		};
+
+		static void throw_error(int status, const char* message)
+		{
+			throw LuaException(status, std::string(message ? message : "unknown error"));
+		}
+
+		//worker running on this thread. POD for __declspec(thread)
+		struct WorkerSlot
+		{
+			const Executor* owner;
+			size_t index;
+		};
+		static WorkerSlot& currentSlot()
+		{
+			static KAGUYA_EXECUTOR_THREAD_LOCAL WorkerSlot slot = { 0, 0 };
+			return slot;
+		}
+
+		void push(const job_type& job)
+		{
+			size_t index = currentWorker();
+			if (index == workers_.size())
+			{
+				index = next_++ % workers_.size();
+			}
+			{
+				std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+				workers_[index]->queue.push_back(job);
+			}
+			pending_++;
+			if (sleeping_ > 0)
+			{//lock so that worker between predicate check and wait does not miss notify
+				std::lock_guard<std::mutex> lock(sleep_mutex_);
+				wakeup_.notify_one();
+			}
+		}
+
+		//return index of worker running on this thread, or workers_.size()
+		size_t currentWorker()const
+		{
+			const WorkerSlot& slot = currentSlot();
+			return slot.owner == this ? slot.index : workers_.size();
+		}
+
+		//decrement pending count if positive
+		bool claim()
+		{
+			size_t count = pending_.load();
+			while (count > 0)
+			{
+				if (pending_.compare_exchange_weak(count, count - 1))
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool take(size_t index, job_type& job)
+		{
+			{//own queue from front
+				Worker& worker = *workers_[index];
+				std::lock_guard<std::mutex> lock(worker.mutex);
+				if (!worker.queue.empty())
+				{
+					job.swap(worker.queue.front());
+					worker.queue.pop_front();
+					return true;
+				}
+			}
+			for (size_t i = 1; i < workers_.size(); ++i)
+			{//steal from back
+				Worker& victim = *workers_[(index + i) % workers_.size()];
+				std::lock_guard<std::mutex> lock(victim.mutex);
+				if (!victim.queue.empty())
+				{
+					job.swap(victim.queue.back());
+					victim.queue.pop_back();
+					stolen_count_++;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void run(size_t index)
+		{
+			WorkerSlot& slot = currentSlot();
+			slot.owner = this;
+			slot.index = index;
+			State& state = workers_[index]->state;
+			for (;;)
+			{
+				if (!claim())
+				{
+					std::unique_lock<std::mutex> lock(sleep_mutex_);
+					sleeping_++;
+					wakeup_.wait(lock, [this] { return pending_ > 0 || stop_; });
+					sleeping_--;
+					if (!claim())
+					{
+						if (stop_)
+						{
+							return;//stop and no job
+						}
+						continue;//taken by other worker
+					}
+				}
+				job_type job;
+				while (!take(index, job))
+				{//job is pushed before pending count is increased. never fails in practice
+					std::this_thread::yield();
+				}
+				job(state);
+				lua_settop(state.state(), 0);
+			}
+		}
+
+		std::vector<std::unique_ptr<Worker> > workers_;
+		std::mutex sleep_mutex_;//only for sleep and wake up of idle workers
+		std::condition_variable wakeup_;
+		std::atomic<size_t> pending_;
+		std::atomic<size_t> sleeping_;
+		bool stop_;
+		std::atomic<size_t> next_;
+		std::atomic<size_t> stolen_count_;
+	};
+}
+#endif
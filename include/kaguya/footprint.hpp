@@ -0,0 +1,226 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <cstring>
+
+#include "kaguya/config.hpp"
+#include "kaguya/utility.hpp"
+#include "kaguya/object.hpp"
+#include "kaguya/native_function.hpp"
+
+namespace kaguya
+{
+	//! memory size of wrappers holding T in userdata
+	struct TypeFootprint
+	{
+		TypeFootprint() :object_size(0), value_wrapper_size(0), pointer_wrapper_size(0), shared_ptr_wrapper_size(0) {}
+		//! sizeof(T)
+		size_t object_size;
+		//! userdata size of object pushed by value
+		size_t value_wrapper_size;
+		//! userdata size of object pushed by pointer or reference
+		size_t pointer_wrapper_size;
+		//! userdata size of object pushed by shared_ptr. shared_ptr control block is not included
+		size_t shared_ptr_wrapper_size;
+
+		//! bytes added to each object pushed by value (vtable pointer and padding)
+		size_t valueOverhead()const { return value_wrapper_size - object_size; }
+	};
+
+	template<typename T>
+	TypeFootprint typeFootprint()
+	{
+		TypeFootprint result;
+		result.object_size = sizeof(T);
+		result.value_wrapper_size = sizeof(ObjectWrapper<T>);
+		result.pointer_wrapper_size = sizeof(ObjectPointerWrapper<T>);
+		result.shared_ptr_wrapper_size = sizeof(ObjectSmartPointerWrapper<standard::shared_ptr<T> >);
+		return result;
+	}
+	//! userdata size of a bound function overload
+	inline size_t functorFootprint()
+	{
+		return sizeof(FunctorType);
+	}
+
+	//! live userdata of a metatable
+	struct UserdataFootprint
+	{
+		UserdataFootprint() :count(0), bytes(0) {}
+		size_t count;
+		//! sum of userdata block size. Lua object header is not included
+		size_t bytes;
+	};
+	typedef std::map<std::string, UserdataFootprint> UserdataFootprintMap;
+
+	namespace footprint_detail
+	{
+		inline size_t rawlen(lua_State* l, int index)
+		{
+#if LUA_VERSION_NUM >= 502
+			return lua_rawlen(l, index);
+#else
+			return lua_objlen(l, index);
+#endif
+		}
+		//append collectable value at index to worklist if not visited
+		inline void mark(lua_State* l, int index, int visited, int worklist, int& size)
+		{
+			int type = lua_type(l, index);
+			if (type != LUA_TTABLE && type != LUA_TFUNCTION && type != LUA_TUSERDATA && type != LUA_TTHREAD)
+			{
+				return;
+			}
+			index = lua_absindex(l, index);
+			lua_pushvalue(l, index);
+			lua_rawget(l, visited);
+			bool seen = lua_toboolean(l, -1) != 0;
+			lua_pop(l, 1);
+			if (seen)
+			{
+				return;
+			}
+			lua_pushvalue(l, index);
+			lua_pushboolean(l, 1);
+			lua_rawset(l, visited);
+			lua_pushvalue(l, index);
+			lua_rawseti(l, worklist, ++size);
+		}
+	}
+
+	/**
+	* @brief count live userdata reachable from registry by metatable name (__name field).
+	* Walks tables, metatables, upvalues, user values and thread stacks. Cost is proportional to heap size.
+	* Weak side of weak tables (__mode) is not followed. Values of weak keyed tables are followed even if the key is dead.
+	* Key of kaguya object is metatableName<T>(). Userdata without metatable is counted as "(no metatable)".
+	* @code
+	* kaguya::UserdataFootprintMap footprint = kaguya::userdataFootprint(state.state());
+	* size_t vec3_count = footprint[kaguya::metatableName<Vec3>()].count;
+	* @endcode
+	*/
+	inline UserdataFootprintMap userdataFootprint(lua_State* l)
+	{
+		using namespace footprint_detail;
+		UserdataFootprintMap result;
+		util::ScopedSavedStack save(l);
+		int base = lua_gettop(l);
+		lua_newtable(l);
+		int visited = lua_gettop(l);
+		lua_newtable(l);
+		int worklist = lua_gettop(l);
+		int size = 0;
+
+		lua_pushvalue(l, LUA_REGISTRYINDEX);
+		mark(l, -1, visited, worklist, size);
+#if LUA_VERSION_NUM < 502
+		lua_pushvalue(l, LUA_GLOBALSINDEX);
+		mark(l, -1, visited, worklist, size);
+#endif
+		lua_pushthread(l);
+		mark(l, -1, visited, worklist, size);
+		lua_settop(l, worklist);
+
+		while (size > 0)
+		{
+			luaL_checkstack(l, 8, "userdataFootprint");
+			lua_rawgeti(l, worklist, size);
+			lua_pushnil(l);
+			lua_rawseti(l, worklist, size);
+			size--;
+			int object = lua_gettop(l);
+			switch (lua_type(l, object))
+			{
+			case LUA_TTABLE:
+			{
+				bool weak_keys = false;
+				bool weak_values = false;
+				if (lua_getmetatable(l, object))
+				{
+					lua_pushstring(l, "__mode");
+					lua_rawget(l, -2);
+					if (lua_type(l, -1) == LUA_TSTRING)
+					{
+						const char* mode = lua_tostring(l, -1);
+						weak_keys = std::strchr(mode, 'k') != 0;
+						weak_values = std::strchr(mode, 'v') != 0;
+					}
+					lua_pop(l, 1);
+					mark(l, -1, visited, worklist, size);
+					lua_pop(l, 1);
+				}
+				lua_pushnil(l);
+				while (lua_next(l, object))
+				{
+					if (!weak_keys) { mark(l, -2, visited, worklist, size); }
+					if (!weak_values) { mark(l, -1, visited, worklist, size); }
+					lua_pop(l, 1);
+				}
+				break;
+			}
+			case LUA_TFUNCTION:
+				for (int i = 1; lua_getupvalue(l, object, i); ++i)
+				{
+					mark(l, -1, visited, worklist, size);
+					lua_pop(l, 1);
+				}
+				break;
+			case LUA_TUSERDATA:
+			{
+				std::string name = "(no metatable)";
+				if (lua_getmetatable(l, object))
+				{
+					lua_pushstring(l, "__name");
+					lua_rawget(l, -2);
+					if (lua_type(l, -1) == LUA_TSTRING)
+					{
+						name = lua_tostring(l, -1);
+					}
+					lua_pop(l, 1);
+					mark(l, -1, visited, worklist, size);
+					lua_pop(l, 1);
+				}
+				UserdataFootprint& footprint = result[name];
+				footprint.count++;
+				footprint.bytes += rawlen(l, object);
+#if LUA_VERSION_NUM >= 502
+				lua_getuservalue(l, object);
+#else
+				lua_getfenv(l, object);
+#endif
+				mark(l, -1, visited, worklist, size);
+				break;
+			}
+			case LUA_TTHREAD:
+			{
+				lua_State* thread = lua_tothread(l, object);
+				if (thread == l)
+				{//values below this function
+					for (int i = 1; i <= base; ++i)
+					{
+						mark(l, i, visited, worklist, size);
+					}
+				}
+				else
+				{
+					int top = lua_gettop(thread);
+					for (int i = 1; i <= top; ++i)
+					{
+						if (!lua_checkstack(thread, 1))
+						{//stack of suspended thread may be full
+							break;
+						}
+						lua_pushvalue(thread, i);
+						lua_xmove(thread, l, 1);
+						mark(l, -1, visited, worklist, size);
+						lua_pop(l, 1);
+					}
+				}
+				break;
+			}
+			}
+			lua_settop(l, object - 1);
+		}
+		return result;
+	}
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <ctime>
+
+#include "kaguya/config.hpp"
+
+#if KAGUYA_USE_CPP11
+#include <chrono>
+#endif
+
+namespace kaguya
+{
+	//! result of GCController::step
+	struct GCReport
+	{
+		GCReport() :elapsed(0), steps(0), step_kbytes(0), reclaimed_bytes(0), allocated_bytes(0), used_bytes(0), cycle_finished(false) {}
+		//! seconds spent in collector
+		double elapsed;
+		//! number of lua_gc(LUA_GCSTEP) calls
+		size_t steps;
+		//! step size argument used for this call
+		int step_kbytes;
+		//! decrease of memory in use during this call
+		size_t reclaimed_bytes;
+		//! increase of memory in use since previous call
+		size_t allocated_bytes;
+		//! memory in use after this call
+		size_t used_bytes;
+		//! a collection cycle finished in this call
+		bool cycle_finished;
+	};
+
+	/**
+	* Incremental garbage collection driven by time budget.
+	* Call step() once per frame or request. It performs incremental steps until budget is consumed
+	* or a collection cycle finishes. Step size adapts to allocation since previous call
+	* so that collector keeps up with allocation.
+	* If take_over is true, automatic collection is stopped while controller exists,
+	* and collection runs only in step(). Destructor restarts it only if it was running on construction
+	* (always assumed running on Lua 5.1).
+	* @code
+	* kaguya::GCController gc(state.state(), true);
+	* //each frame
+	* kaguya::GCReport report = gc.step(0.002);//2ms
+	* @endcode
+	*/
+	class GCController
+	{
+	public:
+		typedef double(*clock_type)();
+
+		explicit GCController(lua_State* state, bool take_over = false)
+			:state_(state), take_over_(take_over), clock_(&default_clock), min_step_kbytes_(1), max_step_kbytes_(1024)
+			, work_ratio_(2.0), step_kbytes_(8), average_step_time_(0), last_used_bytes_(usedBytes()), was_running_(true)
+		{
+			if (take_over_)
+			{
+#if LUA_VERSION_NUM >= 502
+				was_running_ = lua_gc(state_, LUA_GCISRUNNING, 0) != 0;
+#endif
+				lua_gc(state_, LUA_GCSTOP, 0);
+			}
+		}
+		~GCController()
+		{
+			if (take_over_ && was_running_)
+			{
+				lua_gc(state_, LUA_GCRESTART, 0);
+			}
+		}
+
+		/**
+		* @brief perform incremental collection within budget.
+		* At least one step is performed even if budget is zero.
+		* @param budget seconds
+		*/
+		GCReport step(double budget)
+		{
+			GCReport report;
+			size_t before = usedBytes();
+			report.allocated_bytes = before > last_used_bytes_ ? before - last_used_bytes_ : 0;
+			adaptStepSize(report.allocated_bytes, budget);
+			report.step_kbytes = step_kbytes_;
+
+			double start = clock_();
+			double now = start;
+			do
+			{
+				double step_start = now;
+				report.cycle_finished = lua_gc(state_, LUA_GCSTEP, step_kbytes_) == 1;
+				report.steps++;
+				now = clock_();
+				double step_time = now - step_start;
+				average_step_time_ = average_step_time_ == 0 ? step_time : average_step_time_ * 0.875 + step_time * 0.125;
+			} while (!report.cycle_finished && now - start + average_step_time_ <= budget);
+
+			report.elapsed = now - start;
+			report.used_bytes = usedBytes();
+			report.reclaimed_bytes = before > report.used_bytes ? before - report.used_bytes : 0;
+			last_used_bytes_ = report.used_bytes;
+			last_report_ = report;
+			return report;
+		}
+
+		//! set range of step size argument of lua_gc(LUA_GCSTEP)
+		void setStepRange(int min_kbytes, int max_kbytes)
+		{
+			min_step_kbytes_ = min_kbytes;
+			max_step_kbytes_ = max_kbytes;
+		}
+		/**
+		* @brief set collection work per allocated byte.
+		* 2.0 means collector traverses twice as allocated memory per call (like step multiplier 200)
+		*/
+		void setWorkRatio(double ratio) { work_ratio_ = ratio; }
+		//! set clock function returns seconds. default is monotonic clock if KAGUYA_USE_CPP11, otherwise std::clock
+		void setClock(clock_type clock) { clock_ = clock; }
+
+		const GCReport& lastReport()const { return last_report_; }
+		//! return memory in use by Lua in bytes
+		size_t usedBytes()const
+		{
+			return size_t(lua_gc(state_, LUA_GCCOUNT, 0)) * 1024 + size_t(lua_gc(state_, LUA_GCCOUNTB, 0));
+		}
+	private:
+		//non copyable
+		GCController(const GCController&);
+		GCController& operator =(const GCController&);
+
+		static double default_clock()
+		{
+#if KAGUYA_USE_CPP11
+			return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+			return double(std::clock()) / CLOCKS_PER_SEC;
+#endif
+		}
+
+		void adaptStepSize(size_t allocated_bytes, double budget)
+		{
+			if (average_step_time_ <= 0)
+			{
+				return;
+			}
+			double affordable_steps = budget / average_step_time_;
+			if (affordable_steps < 1)
+			{
+				affordable_steps = 1;
+			}
+			double work_kbytes = allocated_bytes * work_ratio_ / 1024;
+			int size = int(work_kbytes / affordable_steps);
+			if (size < min_step_kbytes_) { size = min_step_kbytes_; }
+			if (size > max_step_kbytes_) { size = max_step_kbytes_; }
+			step_kbytes_ = size;
+		}
+
+		lua_State* state_;
+		bool take_over_;
+		clock_type clock_;
+		int min_step_kbytes_;
+		int max_step_kbytes_;
+		double work_ratio_;
+		int step_kbytes_;
+		double average_step_time_;
+		size_t last_used_bytes_;
+		GCReport last_report_;
+		bool was_running_;
+	};
+}
@@ -52,7 +52,7 @@ struct StdFunInvoker1:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
+    result+=util::typeName<T1>();
     return result;
   }
 };
@@ -90,8 +90,8 @@ struct StdFunInvoker2:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
     return result;
   }
 };
@@ -130,9 +130,9 @@ struct StdFunInvoker3:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
     return result;
   }
 };
@@ -172,10 +172,10 @@ struct StdFunInvoker4:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
     return result;
   }
 };
@@ -216,11 +216,11 @@ struct StdFunInvoker5:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
     return result;
   }
 };
@@ -262,12 +262,12 @@ struct StdFunInvoker6:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
     return result;
   }
 };
@@ -310,13 +310,13 @@ struct StdFunInvoker7:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
     return result;
   }
 };
@@ -360,14 +360,14 @@ struct StdFunInvoker8:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
-    result+=std::string(",")+typeid(T8).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
+    result+=std::string(",")+util::typeName<T8>();
     return result;
   }
 };
@@ -412,15 +412,15 @@ struct StdFunInvoker9:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
-    result+=std::string(",")+typeid(T8).name();
-    result+=std::string(",")+typeid(T9).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
+    result+=std::string(",")+util::typeName<T8>();
+    result+=std::string(",")+util::typeName<T9>();
     return result;
   }
 };
@@ -481,7 +481,7 @@ struct VoidStdFunInvoker1:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
+    result+=util::typeName<T1>();
     return result;
   }
 };
@@ -516,8 +516,8 @@ struct VoidStdFunInvoker2:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
     return result;
   }
 };
@@ -553,9 +553,9 @@ struct VoidStdFunInvoker3:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
     return result;
   }
 };
@@ -592,10 +592,10 @@ struct VoidStdFunInvoker4:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
     return result;
   }
 };
@@ -633,11 +633,11 @@ struct VoidStdFunInvoker5:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
     return result;
   }
 };
@@ -676,12 +676,12 @@ struct VoidStdFunInvoker6:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
     return result;
   }
 };
@@ -721,13 +721,13 @@ struct VoidStdFunInvoker7:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
     return result;
   }
 };
@@ -768,14 +768,14 @@ struct VoidStdFunInvoker8:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
-    result+=std::string(",")+typeid(T8).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
+    result+=std::string(",")+util::typeName<T8>();
     return result;
   }
 };
@@ -817,15 +817,15 @@ struct VoidStdFunInvoker9:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
-    result+=std::string(",")+typeid(T8).name();
-    result+=std::string(",")+typeid(T9).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
+    result+=std::string(",")+util::typeName<T8>();
+    result+=std::string(",")+util::typeName<T9>();
     return result;
   }
 };
@@ -890,7 +890,7 @@ struct FunInvoker1:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
+    result+=util::typeName<T1>();
     return result;
   }
 };
@@ -928,8 +928,8 @@ struct FunInvoker2:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
     return result;
   }
 };
@@ -968,9 +968,9 @@ struct FunInvoker3:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
     return result;
   }
 };
@@ -1010,10 +1010,10 @@ struct FunInvoker4:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
     return result;
   }
 };
@@ -1054,11 +1054,11 @@ struct FunInvoker5:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
     return result;
   }
 };
@@ -1100,12 +1100,12 @@ struct FunInvoker6:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
     return result;
   }
 };
@@ -1148,13 +1148,13 @@ struct FunInvoker7:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
     return result;
   }
 };
@@ -1198,14 +1198,14 @@ struct FunInvoker8:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
-    result+=std::string(",")+typeid(T8).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
+    result+=std::string(",")+util::typeName<T8>();
     return result;
   }
 };
@@ -1250,15 +1250,15 @@ struct FunInvoker9:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
-    result+=std::string(",")+typeid(T8).name();
-    result+=std::string(",")+typeid(T9).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
+    result+=std::string(",")+util::typeName<T8>();
+    result+=std::string(",")+util::typeName<T9>();
     return result;
   }
 };
@@ -1319,7 +1319,7 @@ struct VoidFunInvoker1:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
+    result+=util::typeName<T1>();
     return result;
   }
 };
@@ -1354,8 +1354,8 @@ struct VoidFunInvoker2:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
     return result;
   }
 };
@@ -1391,9 +1391,9 @@ struct VoidFunInvoker3:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
     return result;
   }
 };
@@ -1430,10 +1430,10 @@ struct VoidFunInvoker4:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
     return result;
   }
 };
@@ -1471,11 +1471,11 @@ struct VoidFunInvoker5:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
     return result;
   }
 };
@@ -1514,12 +1514,12 @@ struct VoidFunInvoker6:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
     return result;
   }
 };
@@ -1559,13 +1559,13 @@ struct VoidFunInvoker7:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
     return result;
   }
 };
@@ -1606,14 +1606,14 @@ struct VoidFunInvoker8:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
-    result+=std::string(",")+typeid(T8).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
+    result+=std::string(",")+util::typeName<T8>();
     return result;
   }
 };
@@ -1655,15 +1655,15 @@ struct VoidFunInvoker9:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
-    result+=std::string(",")+typeid(T8).name();
-    result+=std::string(",")+typeid(T9).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
+    result+=std::string(",")+util::typeName<T8>();
+    result+=std::string(",")+util::typeName<T9>();
     return result;
   }
 };
@@ -1767,7 +1767,7 @@ if(types::get(state, 1, types::typetag< T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
+    result+=util::typeName<T1>();
     return result;
   }
 };
@@ -1807,7 +1807,7 @@ if(types::get(state, 1, types::typetag<const T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
+    result+=util::typeName<T1>();
     return result;
   }
 };
@@ -1848,8 +1848,8 @@ if(types::get(state, 1, types::typetag< T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
     return result;
   }
 };
@@ -1890,8 +1890,8 @@ if(types::get(state, 1, types::typetag<const T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
     return result;
   }
 };
@@ -1933,9 +1933,9 @@ if(types::get(state, 1, types::typetag< T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
     return result;
   }
 };
@@ -1977,9 +1977,9 @@ if(types::get(state, 1, types::typetag<const T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
     return result;
   }
 };
@@ -2022,10 +2022,10 @@ if(types::get(state, 1, types::typetag< T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
     return result;
   }
 };
@@ -2068,10 +2068,10 @@ if(types::get(state, 1, types::typetag<const T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
     return result;
   }
 };
@@ -2115,11 +2115,11 @@ if(types::get(state, 1, types::typetag< T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
     return result;
   }
 };
@@ -2163,11 +2163,11 @@ if(types::get(state, 1, types::typetag<const T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
     return result;
   }
 };
@@ -2212,12 +2212,12 @@ if(types::get(state, 1, types::typetag< T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
     return result;
   }
 };
@@ -2262,12 +2262,12 @@ if(types::get(state, 1, types::typetag<const T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
     return result;
   }
 };
@@ -2313,13 +2313,13 @@ if(types::get(state, 1, types::typetag< T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
     return result;
   }
 };
@@ -2365,13 +2365,13 @@ if(types::get(state, 1, types::typetag<const T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
     return result;
   }
 };
@@ -2418,14 +2418,14 @@ if(types::get(state, 1, types::typetag< T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
-    result+=std::string(",")+typeid(T8).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
+    result+=std::string(",")+util::typeName<T8>();
     return result;
   }
 };
@@ -2472,14 +2472,14 @@ if(types::get(state, 1, types::typetag<const T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
-    result+=std::string(",")+typeid(T8).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
+    result+=std::string(",")+util::typeName<T8>();
     return result;
   }
 };
@@ -2527,15 +2527,15 @@ if(types::get(state, 1, types::typetag< T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
-    result+=std::string(",")+typeid(T8).name();
-    result+=std::string(",")+typeid(T9).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
+    result+=std::string(",")+util::typeName<T8>();
+    result+=std::string(",")+util::typeName<T9>();
     return result;
   }
 };
@@ -2583,15 +2583,15 @@ if(types::get(state, 1, types::typetag<const T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
-    result+=std::string(",")+typeid(T8).name();
-    result+=std::string(",")+typeid(T9).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
+    result+=std::string(",")+util::typeName<T8>();
+    result+=std::string(",")+util::typeName<T9>();
     return result;
   }
 };
@@ -2690,7 +2690,7 @@ if(types::get(state, 1, types::typetag< T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
+    result+=util::typeName<T1>();
     return result;
   }
 };
@@ -2727,7 +2727,7 @@ if(types::get(state, 1, types::typetag<const T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
+    result+=util::typeName<T1>();
     return result;
   }
 };
@@ -2765,8 +2765,8 @@ if(types::get(state, 1, types::typetag< T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
     return result;
   }
 };
@@ -2804,8 +2804,8 @@ if(types::get(state, 1, types::typetag<const T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
     return result;
   }
 };
@@ -2844,9 +2844,9 @@ if(types::get(state, 1, types::typetag< T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
     return result;
   }
 };
@@ -2885,9 +2885,9 @@ if(types::get(state, 1, types::typetag<const T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
     return result;
   }
 };
@@ -2927,10 +2927,10 @@ if(types::get(state, 1, types::typetag< T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
     return result;
   }
 };
@@ -2970,10 +2970,10 @@ if(types::get(state, 1, types::typetag<const T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
     return result;
   }
 };
@@ -3014,11 +3014,11 @@ if(types::get(state, 1, types::typetag< T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
     return result;
   }
 };
@@ -3059,11 +3059,11 @@ if(types::get(state, 1, types::typetag<const T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
     return result;
   }
 };
@@ -3105,12 +3105,12 @@ if(types::get(state, 1, types::typetag< T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
     return result;
   }
 };
@@ -3152,12 +3152,12 @@ if(types::get(state, 1, types::typetag<const T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
     return result;
   }
 };
@@ -3200,13 +3200,13 @@ if(types::get(state, 1, types::typetag< T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
     return result;
   }
 };
@@ -3249,13 +3249,13 @@ if(types::get(state, 1, types::typetag<const T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
     return result;
   }
 };
@@ -3299,14 +3299,14 @@ if(types::get(state, 1, types::typetag< T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
-    result+=std::string(",")+typeid(T8).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
+    result+=std::string(",")+util::typeName<T8>();
     return result;
   }
 };
@@ -3350,14 +3350,14 @@ if(types::get(state, 1, types::typetag<const T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
-    result+=std::string(",")+typeid(T8).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
+    result+=std::string(",")+util::typeName<T8>();
     return result;
   }
 };
@@ -3402,15 +3402,15 @@ if(types::get(state, 1, types::typetag< T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
-    result+=std::string(",")+typeid(T8).name();
-    result+=std::string(",")+typeid(T9).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
+    result+=std::string(",")+util::typeName<T8>();
+    result+=std::string(",")+util::typeName<T9>();
     return result;
   }
 };
@@ -3455,15 +3455,15 @@ if(types::get(state, 1, types::typetag<const T1*>()) == 0){return false;}
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
-    result+=std::string(",")+typeid(T8).name();
-    result+=std::string(",")+typeid(T9).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
+    result+=std::string(",")+util::typeName<T8>();
+    result+=std::string(",")+util::typeName<T9>();
     return result;
   }
 };
@@ -3518,7 +3518,7 @@ struct ConstructorInvoker1:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
+    result+=util::typeName<T1>();
     return result;
   }
 };
@@ -3546,8 +3546,8 @@ struct ConstructorInvoker2:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
     return result;
   }
 };
@@ -3576,9 +3576,9 @@ struct ConstructorInvoker3:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
     return result;
   }
 };
@@ -3608,10 +3608,10 @@ struct ConstructorInvoker4:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
     return result;
   }
 };
@@ -3642,11 +3642,11 @@ struct ConstructorInvoker5:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
     return result;
   }
 };
@@ -3678,12 +3678,12 @@ struct ConstructorInvoker6:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
     return result;
   }
 };
@@ -3716,13 +3716,13 @@ struct ConstructorInvoker7:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
     return result;
   }
 };
@@ -3756,14 +3756,14 @@ struct ConstructorInvoker8:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
-    result+=std::string(",")+typeid(T8).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
+    result+=std::string(",")+util::typeName<T8>();
     return result;
   }
 };
@@ -3798,15 +3798,15 @@ struct ConstructorInvoker9:BaseInvoker{
   }
   virtual std::string argumentTypeNames(){
     std::string result;
-    result+=typeid(T1).name();
-    result+=std::string(",")+typeid(T2).name();
-    result+=std::string(",")+typeid(T3).name();
-    result+=std::string(",")+typeid(T4).name();
-    result+=std::string(",")+typeid(T5).name();
-    result+=std::string(",")+typeid(T6).name();
-    result+=std::string(",")+typeid(T7).name();
-    result+=std::string(",")+typeid(T8).name();
-    result+=std::string(",")+typeid(T9).name();
+    result+=util::typeName<T1>();
+    result+=std::string(",")+util::typeName<T2>();
+    result+=std::string(",")+util::typeName<T3>();
+    result+=std::string(",")+util::typeName<T4>();
+    result+=std::string(",")+util::typeName<T5>();
+    result+=std::string(",")+util::typeName<T6>();
+    result+=std::string(",")+util::typeName<T7>();
+    result+=std::string(",")+util::typeName<T8>();
+    result+=std::string(",")+util::typeName<T9>();
     return result;
   }
 };
@@ -0,0 +1,209 @@
+//definitions of kaguya/error_handler.hpp. compiled in src/kaguya.cpp if KAGUYA_SEPARATE_COMPILATION
+#pragma once
+
+namespace kaguya
+{
+	KAGUYA_DECL void ErrorHandler::handle(const char* message, lua_State *state)
+	{
+		function_ptr* slot = getFunctionPointer(state);
+		if (slot && *slot)
+		{
+			function_ptr handler = *slot;
+			if (*handler)
+			{
+				(*handler)(0, message);
+			}
+		}
+	}
+	KAGUYA_DECL void ErrorHandler::handle(int status_code, lua_State *state)
+	{
+		function_ptr* slot = getFunctionPointer(state);
+		if (slot && *slot)
+		{
+			function_ptr handler = *slot;
+			if (*handler)
+			{
+				(*handler)(status_code, get_error_message(state));
+			}
+		}
+	}
+
+	KAGUYA_DECL ErrorHandler::function_type ErrorHandler::getHandler(lua_State* state)
+	{
+
+		function_ptr* slot = getFunctionPointer(state);
+		if (slot && *slot)
+		{
+			return **slot;
+		}
+		return function_type();
+	}
+
+
+	KAGUYA_DECL void ErrorHandler::unregisterHandler(lua_State* state)
+	{
+		if (state)
+		{
+			function_ptr* slot = getFunctionPointer(state);
+			if (slot)
+			{
+				slot->reset();
+			}
+		}
+	}
+	KAGUYA_DECL void ErrorHandler::registerHandler(lua_State* state, function_type f)
+	{
+		if (state)
+		{
+			util::ScopedSavedStack save(state);
+			lua_pushlightuserdata(state, this);
+			if (class_userdata::newmetatable<function_ptr>(state))//register error handler destructor to Lua state
+			{
+				lua_pushcclosure(state, &error_handler_cleanner, 0);
+				lua_setfield(state, -2, "__gc");
+				lua_setfield(state, -1, "__index");
+				void* ptr = lua_newuserdata(state, sizeof(function_ptr));//dummy data for gc call
+				if (!ptr) { throw std::runtime_error("critical error. maybe failed memory allocation"); }//critical error
+				function_ptr* slot = new(ptr) function_ptr();
+				if (!slot) { throw std::runtime_error("critical error. maybe failed memory allocation"); }//critical error
+				class_userdata::setmetatable<function_ptr>(state);
+				lua_settable(state, LUA_REGISTRYINDEX);
+				*slot = function_ptr(new function_type(f));
+#if KAGUYA_ERROR_HANDLER_USE_EXTRASPACE
+				setCache(state, slot);
+#endif
+			}
+			else
+			{
+				function_ptr* slot = getFunctionPointer(state);
+				if (slot)
+				{//running handler keeps old function alive
+					*slot = function_ptr(new function_type(f));
+				}
+			}
+		}
+	}
+
+	KAGUYA_DECL void ErrorHandler::initializeState(lua_State* state)
+	{
+#if KAGUYA_ERROR_HANDLER_USE_EXTRASPACE
+		if (state)
+		{
+			//extra space of main thread is not initialized by Lua. clear before lookup
+			setCache(state, 0);
+			setCache(state, getFunctionPointer(state));
+		}
+#endif
+	}
+
+#if KAGUYA_ERROR_HANDLER_USE_EXTRASPACE
+	KAGUYA_DECL void ErrorHandler::setCache(lua_State* state, function_ptr* handler)
+	{
+		if (LUA_EXTRASPACE < sizeof(function_ptr*))
+		{
+			return;//Lua built without room for a pointer. use registry
+		}
+		//write to main thread too. new coroutines copy extra space of main thread
+		lua_rawgeti(state, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);
+		lua_State* main_thread = lua_tothread(state, -1);
+		lua_pop(state, 1);
+		*static_cast<function_ptr**>(lua_getextraspace(state)) = handler;
+		if (main_thread && main_thread != state)
+		{
+			*static_cast<function_ptr**>(lua_getextraspace(main_thread)) = handler;
+		}
+	}
+#endif
+
+	KAGUYA_DECL ErrorHandler& ErrorHandler::instance() {
+		static ErrorHandler instance_;
+		return instance_;
+	}
+
+	KAGUYA_DECL ErrorHandler::function_ptr* ErrorHandler::getFunctionPointer(lua_State* state)
+	{
+		if (state)
+		{
+#if KAGUYA_ERROR_HANDLER_USE_EXTRASPACE
+			if (LUA_EXTRASPACE >= sizeof(function_ptr*))
+			{
+				function_ptr* cached = *static_cast<function_ptr**>(lua_getextraspace(state));
+				if (cached)
+				{
+					return cached;
+				}
+			}
+#endif
+#if LUA_VERSION_NUM >= 502
+			lua_rawgetp(state, LUA_REGISTRYINDEX, this);
+#else
+			lua_pushlightuserdata(state, this);
+			lua_rawget(state, LUA_REGISTRYINDEX);
+#endif
+			function_ptr* ptr = static_cast<function_ptr*>(lua_touserdata(state, -1));
+			lua_pop(state, 1);
+			return ptr;
+		}
+		return 0;
+	}
+
+	KAGUYA_DECL int ErrorHandler::error_handler_cleanner(lua_State *state)
+	{
+		function_ptr* ptr = (function_ptr*)lua_touserdata(state, 1);
+#if KAGUYA_ERROR_HANDLER_USE_EXTRASPACE
+		//memory of closed state may be reused by state not initialized by kaguya
+		setCache(state, 0);
+#endif
+		ptr->~function_ptr();
+		return 0;
+	}
+
+	namespace except
+	{
+		KAGUYA_DECL void OtherError(lua_State *state, const std::string& message)
+		{
+			ErrorHandler::instance().handle(message.c_str(), state);
+#if !KAGUYA_ERROR_NO_THROW
+			throw LuaKaguyaError(message);
+#endif
+		}
+		KAGUYA_DECL void typeMismatchError(lua_State *state, const std::string& message)
+		{
+			ErrorHandler::instance().handle(message.c_str(), state);
+#if !KAGUYA_ERROR_NO_THROW
+			throw LuaTypeMismatch(message);
+#endif
+		}
+		KAGUYA_DECL bool checkErrorAndThrow(int status, lua_State *state)
+		{
+			if (status != 0 && status != LUA_YIELD)
+			{
+				ErrorHandler::instance().handle(status, state);
+#if !KAGUYA_ERROR_NO_THROW
+				const char* message = 0;
+				switch (status)
+				{
+				case LUA_ERRSYNTAX:
+					message = lua_tostring(state, -1);
+					throw LuaSyntaxError(status, message ? std::string(message) : "unknown syntax error");
+				case LUA_ERRRUN:
+					message = lua_tostring(state, -1);
+					throw LuaRuntimeError(status, message ? std::string(message) : "unknown runtime error");
+				case LUA_ERRMEM:
+					throw LuaMemoryError(status, "lua memory allocation error");
+				case LUA_ERRERR:
+					message = lua_tostring(state, -1);
+					throw LuaRunningError(status, message ? std::string(message) : "unknown error");
+				case LUA_ERRGCMM:
+					message = lua_tostring(state, -1);
+					throw LuaGCError(status, message ? std::string(message) : "unknown gc error");
+				default:
+					throw LuaUnknownError(status, "lua unknown error");
+				}
+#endif
+				return false;
+			}
+			return true;
+		}
+	}
+}
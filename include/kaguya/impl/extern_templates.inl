@@ -0,0 +1,24 @@
+//common template instantiations. declared extern in user code and instantiated once in src/kaguya.cpp
+#pragma once
+
+namespace kaguya
+{
+#define KAGUYA_EXTERN_VALUE_TEMPLATE(TYPE) \
+	KAGUYA_EXTERN_TEMPLATE LuaRef::LuaRef(lua_State*, TYPE);\
+	KAGUYA_EXTERN_TEMPLATE bool LuaRef::typeTest<TYPE>()const;\
+	KAGUYA_EXTERN_TEMPLATE bool LuaRef::weakTypeTest<TYPE>()const;\
+	KAGUYA_EXTERN_TEMPLATE TableKeyReference& TableKeyReference::operator=(TYPE);
+
+	KAGUYA_EXTERN_VALUE_TEMPLATE(bool)
+	KAGUYA_EXTERN_VALUE_TEMPLATE(int)
+	KAGUYA_EXTERN_VALUE_TEMPLATE(double)
+	KAGUYA_EXTERN_VALUE_TEMPLATE(std::string)
+	KAGUYA_EXTERN_VALUE_TEMPLATE(const char*)
+#undef KAGUYA_EXTERN_VALUE_TEMPLATE
+
+	KAGUYA_EXTERN_TEMPLATE traits::arg_get_type<bool>::type LuaRef::get<bool>()const;
+	KAGUYA_EXTERN_TEMPLATE traits::arg_get_type<int>::type LuaRef::get<int>()const;
+	KAGUYA_EXTERN_TEMPLATE traits::arg_get_type<double>::type LuaRef::get<double>()const;
+	KAGUYA_EXTERN_TEMPLATE traits::arg_get_type<std::string>::type LuaRef::get<std::string>()const;
+	KAGUYA_EXTERN_TEMPLATE traits::arg_get_type<LuaRef>::type LuaRef::get<LuaRef>()const;
+}
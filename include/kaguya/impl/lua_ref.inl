@@ -0,0 +1,257 @@
+//definitions of non-template members of kaguya/lua_ref.hpp. compiled in src/kaguya.cpp if KAGUYA_SEPARATE_COMPILATION
+#pragma once
+
+namespace kaguya
+{
+	KAGUYA_DECL void LuaRef::unref()
+	{
+		if (!isNilref())
+		{
+			luaL_unref(state_, LUA_REGISTRYINDEX, ref_);
+			state_ = 0;
+			ref_ = LUA_REFNIL;
+		}
+	}
+	KAGUYA_DECL lua_State* LuaRef::toMainThread(lua_State* state)
+	{
+#if LUA_VERSION_NUM >= 502
+		if (state)
+		{
+			lua_rawgeti(state, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);
+			lua_State* mainthread = lua_tothread(state, -1);
+			lua_pop(state, 1);
+			if (mainthread)
+			{
+				return mainthread;
+			}
+		}
+#endif
+		return state;
+	}
+	KAGUYA_DECL LuaRef::LuaRef(const LuaRef& src) :state_(src.state_)
+	{
+		if (!src.isNilref())
+		{
+			src.push(state_);
+			ref_ = luaL_ref(state_, LUA_REGISTRYINDEX);
+		}
+		else
+		{
+			ref_ = LUA_REFNIL;
+		}
+	}
+	KAGUYA_DECL LuaRef& LuaRef::operator =(const LuaRef& src)
+	{
+		unref();
+		state_ = src.state_;
+		if (!src.isNilref())
+		{
+			src.push(state_);
+			ref_ = luaL_ref(state_, LUA_REGISTRYINDEX);
+		}
+		else
+		{
+			ref_ = LUA_REFNIL;
+		}
+		return *this;
+	}
+	KAGUYA_DECL LuaRef::LuaRef(lua_State* state, StackTop, NoMainCheck) :state_(state), ref_(LUA_REFNIL)
+	{
+		ref_ = luaL_ref(state_, LUA_REGISTRYINDEX);
+	}
+	KAGUYA_DECL LuaRef::LuaRef(lua_State* state, StackTop) :state_(state), ref_(LUA_REFNIL)
+	{
+		ref_ = luaL_ref(state_, LUA_REGISTRYINDEX);
+		state_ = toMainThread(state_);
+	}
+	KAGUYA_DECL void LuaRef::push(lua_State* state)const
+	{
+		if (isNilref())
+		{
+			lua_pushnil(state);
+			return;
+		}
+#if LUA_VERSION_NUM >= 502
+		if (state != state_)
+		{//state check
+			assert(toMainThread(state) == toMainThread(state_));
+		}
+#endif
+		lua_rawgeti(state, LUA_REGISTRYINDEX, ref_);
+	}
+	KAGUYA_DECL int LuaRef::threadStatus()const
+	{
+		if (isNilref())
+		{
+			except::typeMismatchError(state_, "is nil");
+			return LUA_ERRRUN;
+		}
+		util::ScopedSavedStack save(state_);
+		lua_State* thread = get<lua_State*>();
+
+		if (!thread)
+		{
+			except::typeMismatchError(state_, "is not thread");
+			return LUA_ERRRUN;
+		}
+		return lua_status(thread);
+	}
+	KAGUYA_DECL LuaRef::coroutine_status LuaRef::costatus(lua_State *l)const
+	{
+		if (isNilref())
+		{
+			except::typeMismatchError(state_, "is nil");
+			return COSTAT_DEAD;
+		}
+
+		lua_State* thread = get<lua_State*>();
+		if (!thread)
+		{
+			except::typeMismatchError(state_, "is not thread");
+			return COSTAT_DEAD;
+		}
+		else if (thread == l)
+		{
+			return COSTAT_RUNNING;
+		}
+		else
+		{
+			switch (lua_status(thread))
+			{
+			case LUA_YIELD:
+				return COSTAT_SUSPENDED;
+			case 0://LUA_OK
+			{
+				if (lua_gettop(thread) == 0)
+				{
+					return COSTAT_DEAD;
+				}
+				else
+				{
+					return COSTAT_SUSPENDED;
+				}
+			}
+			default:
+				break;
+			}
+		}
+		return COSTAT_DEAD;
+
+	}
+	KAGUYA_DECL LuaRef LuaRef::getField(const LuaRef& key)const
+	{
+		if (ref_ == LUA_REFNIL)
+		{
+			except::typeMismatchError(state_, "is nil");
+			return LuaRef(state_);
+		}
+		util::ScopedSavedStack save(state_);
+		push(state_);
+		int t = lua_type(state_, -1);
+		if (t != LUA_TTABLE && t != LUA_TUSERDATA)
+		{
+			except::typeMismatchError(state_, typeName() + "is not table");
+			return LuaRef(state_);
+		}
+		key.push(state_);
+		lua_gettable(state_, -2);
+		return LuaRef(state_, StackTop(), NoMainCheck());
+	}
+	KAGUYA_DECL LuaRef LuaRef::getField(const char* str)const
+	{
+		if (ref_ == LUA_REFNIL)
+		{
+			except::typeMismatchError(state_, "is nil");
+			return LuaRef(state_);
+		}
+		util::ScopedSavedStack save(state_);
+		push(state_);
+		int t = lua_type(state_, -1);
+		if (t != LUA_TTABLE && t != LUA_TUSERDATA)
+		{
+			except::typeMismatchError(state_, typeName() + "is not table");
+			return LuaRef(state_);
+		}
+		types::push_dispatch(state_, str);
+		lua_gettable(state_, -2);
+		return LuaRef(state_, StackTop());
+	}
+	KAGUYA_DECL LuaRef LuaRef::getField(int index)const
+	{
+		if (ref_ == LUA_REFNIL)
+		{
+			except::typeMismatchError(state_, "is nil");
+			return LuaRef(state_);
+		}
+		util::ScopedSavedStack save(state_);
+		push();
+		int t = lua_type(state_, -1);
+		if (t != LUA_TTABLE && t != LUA_TUSERDATA)
+		{
+			except::typeMismatchError(state_, typeName() + "is not table");
+			return LuaRef(state_);
+		}
+		types::push_dispatch(state_, index);
+		lua_gettable(state_, -2);
+		return LuaRef(state_, StackTop(), NoMainCheck());
+	}
+	KAGUYA_DECL LuaRef::value_type LuaRef::type() const
+	{
+		if (ref_ == LUA_REFNIL)
+		{
+			return TYPE_NIL;
+		}
+		util::ScopedSavedStack save(state_);
+		push(state_);
+		return (value_type)lua_type(state_, -1);
+	}
+	KAGUYA_DECL std::string LuaRef::typeName()const
+	{
+		return lua_typename(state_, type());
+	}
+	KAGUYA_DECL bool LuaRef::operator==(const LuaRef& other)const
+	{
+		value_type other_type = other.type();
+		value_type this_type = type();
+		if (other_type != this_type) { return false; }
+		if (other_type == TYPE_NIL) { return true; }
+		util::ScopedSavedStack save(state_);
+		other.push(state_);
+		push();
+#if LUA_VERSION_NUM >= 502
+		return lua_compare(state_, -1, -2, LUA_OPEQ) != 0;
+#else
+		return lua_equal(state_, -1, -2) != 0;
+#endif
+	}
+	KAGUYA_DECL bool LuaRef::operator<(const LuaRef& other)const
+	{
+		value_type other_type = other.type();
+		value_type this_type = type();
+		if (other_type != this_type) { return this_type < other_type; }
+		if (other_type == TYPE_NIL) { return false; }
+		util::ScopedSavedStack save(state_);
+		other.push(state_);
+		push(state_);
+#if LUA_VERSION_NUM >= 502
+		return lua_compare(state_, -1, -2, LUA_OPLT) != 0;
+#else
+		return lua_lessthan(state_, -1, -2) != 0;
+#endif
+	}
+	KAGUYA_DECL bool LuaRef::operator<=(const LuaRef& other)const
+	{
+		value_type other_type = other.type();
+		value_type this_type = type();
+		if (other_type != this_type) { return this_type < other_type; }
+		if (other_type == TYPE_NIL) { return true; }
+		util::ScopedSavedStack save(state_);
+		other.push(state_);
+		push();
+#if LUA_VERSION_NUM >= 502
+		return lua_compare(state_, -1, -2, LUA_OPLE) != 0;
+#else
+		return lua_equal(state_, -1, -2) != 0 || lua_lessthan(state_, -1, -2) != 0;
+#endif
+	}
+}
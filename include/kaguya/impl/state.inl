@@ -0,0 +1,248 @@
+//definitions of kaguya/state.hpp. compiled in src/kaguya.cpp if KAGUYA_SEPARATE_COMPILATION
+#pragma once
+
+namespace kaguya
+{
+	KAGUYA_DECL void State::stderror_out(int status, const char* message)
+	{
+		std::cerr << message << std::endl;
+	}
+	KAGUYA_DECL int State::default_panic(lua_State* state)
+	{
+		const char* message = lua_tostring(state, -1);
+		std::cerr << "PANIC: unprotected error in call to Lua API (" << (message ? message : "") << ")" << std::endl;
+		return 0;
+	}
+	KAGUYA_DECL void State::init()
+	{
+		ErrorHandler::instance().initializeState(state_);
+		if (!ErrorHandler::instance().getHandler(state_))
+		{
+			setErrorHandler(&stderror_out);
+		}
+		nativefunction::reg_functor_destructor(state_);
+	}
+	KAGUYA_DECL int State::loadfileToStack(const char* file)
+	{
+		if (file_loader_)
+		{
+			return file_loader_->load(state_, file);
+		}
+		return luaL_loadfile(state_, file);
+	}
+
+	KAGUYA_DECL State::State() :state_(luaL_newstate()), created_(true)
+	{
+		try
+		{
+			init();
+			openlibs();
+		}
+		catch (...)
+		{//destructor is not called
+			lua_close(state_);
+			throw;
+		}
+	}
+	KAGUYA_DECL State::State(const LoadLibs& libs) :state_(luaL_newstate()), created_(true)
+	{
+		try
+		{
+			init();
+			openlibs(libs);
+		}
+		catch (...)
+		{//destructor is not called
+			lua_close(state_);
+			throw;
+		}
+	}
+	KAGUYA_DECL State::State(lua_State* lua) :state_(lua), created_(false)
+	{
+		init();
+	}
+	KAGUYA_DECL State::~State()
+	{
+		if (created_)
+		{
+			lua_close(state_);
+		}
+	}
+
+	KAGUYA_DECL void State::setErrorHandler(standard::function<void(int statuscode, const char*message)> errorfunction)
+	{
+		util::ScopedSavedStack save(state_);
+		ErrorHandler::instance().registerHandler(state_, errorfunction);
+	}
+
+	KAGUYA_DECL void State::openlibs()
+	{
+		util::ScopedSavedStack save(state_);
+		luaL_openlibs(state_);
+	}
+	KAGUYA_DECL void State::openlib(const LoadLib& lib)
+	{
+		util::ScopedSavedStack save(state_);
+
+		luaL_requiref(state_, lib.first.c_str(), lib.second, 1);
+	}
+	KAGUYA_DECL void State::openlibs(const LoadLibs& libs)
+	{
+		for (LoadLibs::const_iterator it = libs.begin(); it != libs.end(); ++it)
+		{
+			openlib(*it);
+		}
+	}
+
+	KAGUYA_DECL LuaFunction State::loadfile(const std::string& file)
+	{
+		return loadfile(file.c_str());
+	}
+	KAGUYA_DECL LuaFunction State::loadfile(const char* file)
+	{
+		if (!file_loader_)
+		{
+			return LuaFunction::loadfile(state_, file);
+		}
+		util::ScopedSavedStack save(state_);
+
+		int status = loadfileToStack(file);
+
+		if (status)
+		{
+			ErrorHandler::instance().handle(status, state_);
+			return LuaRef(state_);
+		}
+		return LuaFunction(state_, StackTop());
+	}
+
+	KAGUYA_DECL LuaFunction State::loadstring(const std::string& str)
+	{
+		return LuaFunction::loadstring(state_, str);
+	}
+	KAGUYA_DECL LuaFunction State::loadstring(const char* str)
+	{
+		return LuaFunction::loadstring(state_, str);
+	}
+
+	KAGUYA_DECL bool State::dofile(const std::string& file, const LuaTable& env)
+	{
+		return dofile(file.c_str(), env);
+	}
+	KAGUYA_DECL bool State::dofile(const char* file, const LuaTable& env)
+	{
+		util::ScopedSavedStack save(state_);
+
+		int status = loadfileToStack(file);
+
+		if (status)
+		{
+			ErrorHandler::instance().handle(status, state_);
+			return false;
+		}
+
+		if (!env.isNilref())
+		{//register _ENV
+			env.push();
+#if LUA_VERSION_NUM >= 502
+			lua_setupvalue(state_, -2, 1);
+#else
+			lua_setfenv(state_, -2);
+#endif
+		}
+
+		status = lua_pcall(state_, 0, LUA_MULTRET, 0);
+		if (status)
+		{
+			ErrorHandler::instance().handle(status, state_);
+			return false;
+		}
+		return true;
+	}
+
+	KAGUYA_DECL bool State::dostring(const char* str, const LuaTable& env)
+	{
+		util::ScopedSavedStack save(state_);
+
+		int status = luaL_loadstring(state_, str);
+		if (status)
+		{
+			ErrorHandler::instance().handle(status, state_);
+			return false;
+		}
+		if (!env.isNilref())
+		{//register _ENV
+			env.push();
+#if LUA_VERSION_NUM >= 502
+			lua_setupvalue(state_, -2, 1);
+#else
+			lua_setfenv(state_, -2);
+#endif
+		}
+		status = lua_pcall(state_, 0, LUA_MULTRET, 0);
+		if (status)
+		{
+			ErrorHandler::instance().handle(status, state_);
+			return false;
+		}
+		return true;
+	}
+	KAGUYA_DECL bool State::dostring(const std::string& str, const LuaTable& env)
+	{
+		return dostring(str.c_str(), env);
+	}
+	KAGUYA_DECL bool State::operator()(const std::string& str)
+	{
+		return dostring(str);
+	}
+	KAGUYA_DECL bool State::operator()(const char* str)
+	{
+		return dostring(str);
+	}
+
+	KAGUYA_DECL TableKeyReference State::operator[](const std::string& str)
+	{
+		return TableKeyReference(globalTable(), LuaRef(state_, str));
+	}
+	KAGUYA_DECL TableKeyReference State::operator[](const char* str)
+	{
+		return TableKeyReference(globalTable(), LuaRef(state_, str));
+	}
+
+	KAGUYA_DECL LuaTable State::globalTable()
+	{
+		return newRef(GlobalTable());
+	}
+	KAGUYA_DECL LuaTable State::newTable()
+	{
+		return LuaTable(state_);
+	}
+	KAGUYA_DECL LuaTable State::newTable(int reserve_array, int reserve_record)
+	{
+		return LuaTable(state_, NewTable(reserve_array, reserve_record));
+	}
+	KAGUYA_DECL LuaThread State::newThread()
+	{
+		return LuaThread(state_);
+	}
+	KAGUYA_DECL LuaRef State::popFromStack()
+	{
+		return LuaRef(state_, StackTop());
+	}
+
+	KAGUYA_DECL void State::garbageCollect()
+	{
+		gc().collect();
+	}
+	KAGUYA_DECL size_t State::useKBytes()const
+	{
+		return size_t(gc().count());
+	}
+
+	KAGUYA_DECL LuaRef State::newLib()
+	{
+		LuaTable newtable = newTable();
+		newtable.push(state_);
+		return newtable;
+	}
+}
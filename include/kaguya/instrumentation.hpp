@@ -0,0 +1,228 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <ctime>
+
+#include "kaguya/config.hpp"
+
+#if KAGUYA_USE_CPP11
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#endif
+
+namespace kaguya
+{
+	namespace instrumentation
+	{
+		//! bucket i counts calls taking [2^i, 2^(i+1)) nanoseconds. bucket 0 includes zero
+		enum { LATENCY_BUCKETS = 32 };
+
+#if KAGUYA_USE_CPP11
+		typedef std::atomic<unsigned long long> counter_type;
+		typedef std::mutex mutex_type;
+		typedef std::lock_guard<std::mutex> lock_type;
+		inline void add(counter_type& counter, unsigned long long v) { counter.fetch_add(v, std::memory_order_relaxed); }
+		inline unsigned long long load(const counter_type& counter) { return counter.load(std::memory_order_relaxed); }
+		inline void clear(counter_type& counter) { counter.store(0, std::memory_order_relaxed); }
+		inline unsigned long long now_ns()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+#else
+		typedef unsigned long long counter_type;
+		struct mutex_type {};
+		struct lock_type { lock_type(mutex_type&) {} };
+		inline void add(counter_type& counter, unsigned long long v) { counter += v; }
+		inline unsigned long long load(const counter_type& counter) { return counter; }
+		inline void clear(counter_type& counter) { counter = 0; }
+		inline unsigned long long now_ns()
+		{
+			return (unsigned long long)(double(std::clock()) * 1000000000.0 / CLOCKS_PER_SEC);
+		}
+#endif
+
+		inline int latency_bucket(unsigned long long ns)
+		{
+			int bucket = 0;
+			while (ns > 1 && bucket < LATENCY_BUCKETS - 1)
+			{
+				ns >>= 1;
+				bucket++;
+			}
+			return bucket;
+		}
+
+		//! live counters of a bound function. updated by instrumented dispatcher
+		struct BindingStats
+		{
+			BindingStats() :calls(0), overload_failures(0), exceptions(0), total_ns(0)
+			{
+				for (int i = 0; i < LATENCY_BUCKETS; ++i) { clear(latency_histogram[i]); }
+			}
+			void recordCall(unsigned long long ns)
+			{
+				add(calls, 1);
+				add(total_ns, ns);
+				add(latency_histogram[latency_bucket(ns)], 1);
+			}
+			void recordException()
+			{
+				add(calls, 1);
+				add(exceptions, 1);
+			}
+			void recordOverloadFailure()
+			{
+				add(overload_failures, 1);
+			}
+			void reset()
+			{
+				clear(calls);
+				clear(overload_failures);
+				clear(exceptions);
+				clear(total_ns);
+				for (int i = 0; i < LATENCY_BUCKETS; ++i) { clear(latency_histogram[i]); }
+			}
+
+			//! number of invocations including thrown
+			counter_type calls;
+			//! no overload matched arguments
+			counter_type overload_failures;
+			//! invocations thrown C++ exception
+			counter_type exceptions;
+			//! sum of latency of returned invocations
+			counter_type total_ns;
+			counter_type latency_histogram[LATENCY_BUCKETS];
+		private:
+			//non copyable
+			BindingStats(const BindingStats&);
+			BindingStats& operator =(const BindingStats&);
+		};
+
+		//! copy of BindingStats at a point of time
+		struct BindingStatsSnapshot
+		{
+			BindingStatsSnapshot() :calls(0), overload_failures(0), exceptions(0), total_ns(0)
+			{
+				for (int i = 0; i < LATENCY_BUCKETS; ++i) { latency_histogram[i] = 0; }
+			}
+			std::string class_name;
+			std::string member_name;
+			unsigned long long calls;
+			unsigned long long overload_failures;
+			unsigned long long exceptions;
+			unsigned long long total_ns;
+			unsigned long long latency_histogram[LATENCY_BUCKETS];
+
+			//! mean latency of returned invocations in nanoseconds
+			double meanLatencyNs()const
+			{
+				unsigned long long returned = calls - exceptions;
+				return returned ? double(total_ns) / returned : 0;
+			}
+			/**
+			* @brief approximate latency percentile from histogram.
+			* @param p percentile in [0,1]
+			* @return upper bound of bucket containing percentile in nanoseconds
+			*/
+			unsigned long long percentileNs(double p)const
+			{
+				unsigned long long total = 0;
+				for (int i = 0; i < LATENCY_BUCKETS; ++i) { total += latency_histogram[i]; }
+				if (total == 0)
+				{
+					return 0;
+				}
+				unsigned long long rank = (unsigned long long)(p * total);
+				unsigned long long seen = 0;
+				for (int i = 0; i < LATENCY_BUCKETS; ++i)
+				{
+					seen += latency_histogram[i];
+					if (seen > rank)
+					{
+						return 2ULL << i;
+					}
+				}
+				return 2ULL << (LATENCY_BUCKETS - 1);
+			}
+		};
+
+		/**
+		* Process wide table of BindingStats keyed by class and member name.
+		* Entries are created by ClassMetatable on registration and never removed.
+		* @code
+		* std::vector<kaguya::instrumentation::BindingStatsSnapshot> stats = kaguya::instrumentation::Registry::instance().snapshot();
+		* @endcode
+		*/
+		class Registry
+		{
+		public:
+			static Registry& instance()
+			{
+				static Registry registry;
+				return registry;
+			}
+			~Registry()
+			{
+				for (StatsMap::iterator it = stats_.begin(); it != stats_.end(); ++it)
+				{
+					delete it->second;
+				}
+			}
+
+			//! return stats for binding. created if not exist. pointer is valid until program exit
+			BindingStats* binding(const std::string& class_name, const std::string& member_name)
+			{
+				lock_type lock(mutex_);
+				BindingStats*& stats = stats_[std::make_pair(class_name, member_name)];
+				if (!stats)
+				{
+					stats = new BindingStats();
+				}
+				return stats;
+			}
+			//! copy all counters
+			std::vector<BindingStatsSnapshot> snapshot()
+			{
+				lock_type lock(mutex_);
+				std::vector<BindingStatsSnapshot> result;
+				result.reserve(stats_.size());
+				for (StatsMap::const_iterator it = stats_.begin(); it != stats_.end(); ++it)
+				{
+					const BindingStats& s = *it->second;
+					BindingStatsSnapshot snap;
+					snap.class_name = it->first.first;
+					snap.member_name = it->first.second;
+					snap.calls = load(s.calls);
+					snap.overload_failures = load(s.overload_failures);
+					snap.exceptions = load(s.exceptions);
+					snap.total_ns = load(s.total_ns);
+					for (int i = 0; i < LATENCY_BUCKETS; ++i) { snap.latency_histogram[i] = load(s.latency_histogram[i]); }
+					result.push_back(snap);
+				}
+				return result;
+			}
+			//! set all counters to zero
+			void reset()
+			{
+				lock_type lock(mutex_);
+				for (StatsMap::iterator it = stats_.begin(); it != stats_.end(); ++it)
+				{
+					it->second->reset();
+				}
+			}
+		private:
+			Registry() {}
+			//non copyable
+			Registry(const Registry&);
+			Registry& operator =(const Registry&);
+
+			typedef std::map<std::pair<std::string, std::string>, BindingStats*> StatsMap;
+			StatsMap stats_;
+			mutex_type mutex_;
+		};
+	}
+}
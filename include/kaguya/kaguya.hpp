@@ -11,3 +11,6 @@
 #include "kaguya/lua_ref_function.hpp"
 #include "kaguya/ref_tuple.hpp"
 
+#if KAGUYA_SEPARATE_COMPILATION && KAGUYA_USE_CPP11
+#include "kaguya/impl/extern_templates.inl"
+#endif
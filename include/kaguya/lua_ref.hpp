@@ -7,6 +7,7 @@
 #include "kaguya/error_handler.hpp"
 #include "kaguya/type.hpp"
 #include "kaguya/utility.hpp"
+#include "kaguya/optional.hpp"
 
 
 namespace kaguya
@@ -21,6 +22,126 @@ namespace kaguya
 	class FunEvaluator;
 	class mem_fun_binder;
 
+	namespace optional_detail
+	{
+		//conversion of value at index without exception. bound objects are taken by pointer because weak type check accepts any object
+		template<typename T, bool Object = !traits::is_push_specialized<typename traits::remove_const<T>::type>::value>
+		struct value_getter
+		{
+			static optional<T> get(lua_State* l, int index)
+			{
+				if (!types::checkType(l, index, types::typetag<T>()))
+				{
+					return optional<T>();
+				}
+				return optional<T>(types::get(l, index, types::typetag<T>()));
+			}
+		};
+		template<typename T>
+		struct value_getter<T, true>
+		{
+			static optional<T> get(lua_State* l, int index)
+			{
+				const T* pointer = types::get(l, index, types::typetag<const T*>());
+				return pointer ? optional<T>(*pointer) : optional<T>();
+			}
+		};
+		template<typename T>
+		struct getter :value_getter<T> {};
+		template<typename T>
+		struct getter<T*> :value_getter<T*, false> {};
+		//elements are converted one by one. weak type check of container accepts any object element
+		template<typename T>
+		struct getter<std::vector<T> >
+		{
+			static optional<std::vector<T> > get(lua_State* l, int index)
+			{
+				if (lua_type(l, index) != LUA_TTABLE)
+				{
+					return optional<std::vector<T> >();
+				}
+				index = lua_absindex(l, index);
+				std::vector<T> result;
+				lua_pushnil(l);
+				while (lua_next(l, index))
+				{
+					optional<T> value;
+					if (types::checkType(l, -2, types::typetag<size_t>()))
+					{
+						value = getter<T>::get(l, -1);
+					}
+					if (!value)
+					{
+						lua_pop(l, 2);
+						return optional<std::vector<T> >();
+					}
+					result.push_back(*value);
+					lua_pop(l, 1);
+				}
+				return optional<std::vector<T> >(result);
+			}
+		};
+		template<typename K, typename V>
+		struct getter<std::map<K, V> >
+		{
+			static optional<std::map<K, V> > get(lua_State* l, int index)
+			{
+				if (lua_type(l, index) != LUA_TTABLE)
+				{
+					return optional<std::map<K, V> >();
+				}
+				index = lua_absindex(l, index);
+				std::map<K, V> result;
+				lua_pushnil(l);
+				while (lua_next(l, index))
+				{
+					lua_pushvalue(l, -2);//conversion must not modify key used by lua_next
+					optional<K> key = getter<K>::get(l, -1);
+					lua_pop(l, 1);
+					optional<V> value;
+					if (key)
+					{
+						value = getter<V>::get(l, -1);
+					}
+					if (!value)
+					{
+						lua_pop(l, 2);
+						return optional<std::map<K, V> >();
+					}
+					result[*key] = *value;
+					lua_pop(l, 1);
+				}
+				return optional<std::map<K, V> >(result);
+			}
+		};
+		template<typename T>
+		struct getter<const T&>
+		{
+			static optional<const T&> get(lua_State* l, int index)
+			{
+				const T* pointer = types::get(l, index, types::typetag<const T*>());
+				return pointer ? optional<const T&>(*pointer) : optional<const T&>();
+			}
+		};
+		template<typename T>
+		struct getter<T&>
+		{
+			static optional<T&> get(lua_State* l, int index)
+			{
+				T* pointer = types::get(l, index, types::typetag<T*>());
+				return pointer ? optional<T&>(*pointer) : optional<T&>();
+			}
+		};
+
+		//! value type of tryGet<T>. values converted from Lua (e.g. number,string,container) are held by value, bound objects by reference
+		template<typename T>
+		struct result_type
+		{
+			typedef typename traits::arg_get_type<T>::type arg_type;
+			typedef typename traits::remove_const_and_reference<arg_type>::type value_type;
+			typedef typename traits::conditional<traits::is_push_specialized<value_type>::value, value_type, arg_type>::type type;
+		};
+	}
 
 	/**
 	* Reference of Lua any type value.
@@ -36,15 +157,7 @@ namespace kaguya
 		lua_State *state_;
 		int ref_;
 
-		void unref()
-		{
-			if (!isNilref())
-			{
-				luaL_unref(state_, LUA_REGISTRYINDEX, ref_);
-				state_ = 0;
-				ref_ = LUA_REFNIL;
-			}
-		}
+		KAGUYA_DECL void unref();
 
 		struct gettablekey
 		{
@@ -98,30 +211,15 @@ namespace kaguya
 			lua_settable(state_, -3);//thistable[key] = value 
 		}
 
-		static lua_State* toMainThread(lua_State* state)
-		{
-#if LUA_VERSION_NUM >= 502
-			if (state)
-			{
-				lua_rawgeti(state, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);
-				lua_State* mainthread = lua_tothread(state, -1);
-				lua_pop(state, 1);
-				if (mainthread)
-				{
-					return mainthread;
-				}
-			}
-#endif
-			return state;
-		}
+		static KAGUYA_DECL lua_State* toMainThread(lua_State* state);
 
 		template<typename T>
 		bool pushCountCheck(int count)
 		{
 			if (count != 1)
 			{
-				if (count > 1) { except::typeMismatchError(state_, std::string("can not push multiple value:") + typeid(T).name()); }
-				if (count == 0) { except::typeMismatchError(state_, std::string("can not push ") + typeid(T).name() + " value"); }
+				if (count > 1) { except::typeMismatchError(state_, std::string("can not push multiple value:") + util::typeName<T>()); }
+				if (count == 0) { except::typeMismatchError(state_, std::string("can not push ") + util::typeName<T>() + " value"); }
 				return false;
 			}
 			return true;
@@ -131,6 +229,8 @@ namespace kaguya
 
 		struct NoMainCheck {};
 		bool isNilref()const { return state_ == 0 || ref_ == LUA_REFNIL; }
+		//! return lua_State* of reference. null if reference is empty
+		lua_State* state()const { return state_; }
 
 		//! value type of Lua Reference
 		enum value_type
@@ -146,33 +246,8 @@ namespace kaguya
 			TYPE_THREAD = LUA_TTHREAD,//!< thread(coroutine) type
 		};
 
-		LuaRef(const LuaRef& src) :state_(src.state_)
-		{
-			if (!src.isNilref())
-			{
-				src.push(state_);
-				ref_ = luaL_ref(state_, LUA_REGISTRYINDEX);
-			}
-			else
-			{
-				ref_ = LUA_REFNIL;
-			}
-		}
-		LuaRef& operator =(const LuaRef& src)
-		{
-			unref();
-			state_ = src.state_;
-			if (!src.isNilref())
-			{
-				src.push(state_);
-				ref_ = luaL_ref(state_, LUA_REGISTRYINDEX);
-			}
-			else
-			{
-				ref_ = LUA_REFNIL;
-			}
-			return *this;
-		}
+		KAGUYA_DECL LuaRef(const LuaRef& src);
+		KAGUYA_DECL LuaRef& operator =(const LuaRef& src);
 #if KAGUYA_USE_RVALUE_REFERENCE
 		LuaRef(LuaRef&& src)throw() :state_(0), ref_(LUA_REFNIL)
 		{
@@ -189,16 +264,8 @@ namespace kaguya
 		LuaRef(lua_State* state) :state_(state), ref_(LUA_REFNIL) {}
 
 
-		LuaRef(lua_State* state, StackTop, NoMainCheck) :state_(state), ref_(LUA_REFNIL)
-		{
-			ref_ = luaL_ref(state_, LUA_REGISTRYINDEX);
-		}
-
-		LuaRef(lua_State* state, StackTop) :state_(state), ref_(LUA_REFNIL)
-		{
-			ref_ = luaL_ref(state_, LUA_REGISTRYINDEX);
-			state_ = toMainThread(state_);
-		}
+		KAGUYA_DECL LuaRef(lua_State* state, StackTop, NoMainCheck);
+		KAGUYA_DECL LuaRef(lua_State* state, StackTop);
 
 		void swap(LuaRef& other)throw()
 		{
@@ -233,21 +300,7 @@ namespace kaguya
 		{
 			push(state_);
 		}
-		void push(lua_State* state)const
-		{
-			if (isNilref())
-			{
-				lua_pushnil(state);
-				return;
-			}
-#if LUA_VERSION_NUM >= 502
-			if (state != state_)
-			{//state check
-				assert(toMainThread(state) == toMainThread(state_));
-			}
-#endif
-			lua_rawgeti(state, LUA_REGISTRYINDEX, ref_);
-		}
+		KAGUYA_DECL void push(lua_State* state)const;
 
 		template<typename T>
 		bool typeTest()const
@@ -272,11 +325,43 @@ namespace kaguya
 			push(state_);
 			if (!types::checkType(state_, -1, types::typetag<get_type>()))
 			{
-				throw LuaTypeMismatch(typeName() + std::string("is not ") + typeid(T).name());
+				throw LuaTypeMismatch(typeName() + std::string("is not ") + util::typeName<T>());
 			}
 			return types::get(state_, -1, types::typetag<get_type>());
 		}
 
+		/**
+		* @brief get value without exception.
+		* @return converted value, or empty optional if value is not convertible to T
+		* @code
+		* kaguya::optional<int> width = config["width"].tryGet<int>();
+		* @endcode
+		*/
+		template<typename T>
+		optional<typename optional_detail::result_type<T>::type> tryGet()const
+		{
+			typedef typename optional_detail::result_type<T>::type get_type;
+			if (!state_)
+			{
+				return optional<get_type>();
+			}
+			util::ScopedSavedStack save(state_);
+			push(state_);
+			return optional_detail::getter<get_type>::get(state_, -1);
+		}
+
+		//! get value, or default_value if value is not convertible to T. never throw LuaTypeMismatch
+		template<typename T>
+		typename optional_detail::result_type<T>::type getOr(typename optional_detail::result_type<T>::type default_value)const
+		{
+			optional<typename optional_detail::result_type<T>::type> result = tryGet<T>();
+			if (result)
+			{
+				return *result;
+			}
+			return default_value;
+		}
+
 		template<typename T>
 		operator T()const {
 			return get<T>();
@@ -324,23 +409,7 @@ namespace kaguya
 		/**
 		* @return state status
 		*/
-		int threadStatus()const
-		{
-			if (isNilref())
-			{
-				except::typeMismatchError(state_, "is nil");
-				return LUA_ERRRUN;
-			}
-			util::ScopedSavedStack save(state_);
-			lua_State* thread = get<lua_State*>();
-
-			if (!thread)
-			{
-				except::typeMismatchError(state_, "is not thread");
-				return LUA_ERRRUN;
-			}
-			return lua_status(thread);
-		}
+		KAGUYA_DECL int threadStatus()const;
 
 		//! deprecate
 		int thread_status()const
@@ -362,48 +431,7 @@ namespace kaguya
 		/**
 		* @return coroutine status
 		*/
-		coroutine_status costatus(lua_State *l = 0)const
-		{
-			if (isNilref())
-			{
-				except::typeMismatchError(state_, "is nil");
-				return COSTAT_DEAD;
-			}
-
-			lua_State* thread = get<lua_State*>();
-			if (!thread)
-			{
-				except::typeMismatchError(state_, "is not thread");
-				return COSTAT_DEAD;
-			}
-			else if (thread == l)
-			{
-				return COSTAT_RUNNING;
-			}
-			else
-			{
-				switch (lua_status(thread))
-				{
-				case LUA_YIELD:
-					return COSTAT_SUSPENDED;
-				case 0://LUA_OK
-				{
-					if (lua_gettop(thread) == 0)
-					{
-						return COSTAT_DEAD;
-					}
-					else
-					{
-						return COSTAT_SUSPENDED;
-					}
-				}
-				default:
-					break;
-				}
-			}
-			return COSTAT_DEAD;
-
-		}
+		KAGUYA_DECL coroutine_status costatus(lua_State *l = 0)const;
 
 		/**
 		* @return if coroutine status is dead, return true. Otherwise return false
@@ -498,49 +526,13 @@ namespace kaguya
 		* @param key key of table
 		* @return reference of field value
 		*/
-		LuaRef getField(const LuaRef& key)const
-		{
-			if (ref_ == LUA_REFNIL)
-			{
-				except::typeMismatchError(state_, "is nil");
-				return LuaRef(state_);
-			}
-			util::ScopedSavedStack save(state_);
-			push(state_);
-			int t = lua_type(state_, -1);
-			if (t != LUA_TTABLE && t != LUA_TUSERDATA)
-			{
-				except::typeMismatchError(state_, typeName() + "is not table");
-				return LuaRef(state_);
-			}
-			key.push(state_);
-			lua_gettable(state_, -2);
-			return LuaRef(state_, StackTop(), NoMainCheck());
-		}
+		KAGUYA_DECL LuaRef getField(const LuaRef& key)const;
 		/**
 		* @brief value = table[key];
 		* @param key key of table
 		* @return reference of field value
 		*/
-		LuaRef getField(const char* str)const
-		{
-			if (ref_ == LUA_REFNIL)
-			{
-				except::typeMismatchError(state_, "is nil");
-				return LuaRef(state_);
-			}
-			util::ScopedSavedStack save(state_);
-			push(state_);
-			int t = lua_type(state_, -1);
-			if (t != LUA_TTABLE && t != LUA_TUSERDATA)
-			{
-				except::typeMismatchError(state_, typeName() + "is not table");
-				return LuaRef(state_);
-			}
-			types::push_dispatch(state_, str);
-			lua_gettable(state_, -2);
-			return LuaRef(state_, StackTop());
-		}
+		KAGUYA_DECL LuaRef getField(const char* str)const;
 		/**
 		* @brief value = table[key];
 		* @param key key of table
@@ -555,25 +547,7 @@ namespace kaguya
 		* @param key key of table
 		* @return reference of field value
 		*/
-		LuaRef getField(int index)const
-		{
-			if (ref_ == LUA_REFNIL)
-			{
-				except::typeMismatchError(state_, "is nil");
-				return LuaRef(state_);
-			}
-			util::ScopedSavedStack save(state_);
-			push();
-			int t = lua_type(state_, -1);
-			if (t != LUA_TTABLE && t != LUA_TUSERDATA)
-			{
-				except::typeMismatchError(state_, typeName() + "is not table");
-				return LuaRef(state_);
-			}
-			types::push_dispatch(state_, index);
-			lua_gettable(state_, -2);
-			return LuaRef(state_, StackTop(), NoMainCheck());
-		}
+		KAGUYA_DECL LuaRef getField(int index)const;
 		/**
 		* @brief table[key] = value;
 		*/
@@ -669,70 +643,16 @@ namespace kaguya
 		}
 		//@}
 
-		enum value_type type() const
-		{
-			if (ref_ == LUA_REFNIL)
-			{
-				return TYPE_NIL;
-			}
-			util::ScopedSavedStack save(state_);
-			push(state_);
-			return (value_type)lua_type(state_, -1);
-		}
-		std::string typeName()const
-		{
-			return lua_typename(state_, type());
-		}
+		KAGUYA_DECL enum value_type type() const;
+		KAGUYA_DECL std::string typeName()const;
 		/**
 		* @name relational operators
 		* @brief
 		*/
 		//@{
-		bool operator==(const LuaRef& other)const
-		{
-			value_type other_type = other.type();
-			value_type this_type = type();
-			if (other_type != this_type) { return false; }
-			if (other_type == TYPE_NIL) { return true; }
-			util::ScopedSavedStack save(state_);
-			other.push(state_);
-			push();
-#if LUA_VERSION_NUM >= 502
-			return lua_compare(state_, -1, -2, LUA_OPEQ) != 0;
-#else
-			return lua_equal(state_, -1, -2) != 0;
-#endif
-		}
-		bool operator<(const LuaRef& other)const
-		{
-			value_type other_type = other.type();
-			value_type this_type = type();
-			if (other_type != this_type) { return this_type < other_type; }
-			if (other_type == TYPE_NIL) { return false; }
-			util::ScopedSavedStack save(state_);
-			other.push(state_);
-			push(state_);
-#if LUA_VERSION_NUM >= 502
-			return lua_compare(state_, -1, -2, LUA_OPLT) != 0;
-#else
-			return lua_lessthan(state_, -1, -2) != 0;
-#endif
-		}
-		bool operator<=(const LuaRef& other)const
-		{
-			value_type other_type = other.type();
-			value_type this_type = type();
-			if (other_type != this_type) { return this_type < other_type; }
-			if (other_type == TYPE_NIL) { return true; }
-			util::ScopedSavedStack save(state_);
-			other.push(state_);
-			push();
-#if LUA_VERSION_NUM >= 502
-			return lua_compare(state_, -1, -2, LUA_OPLE) != 0;
-#else
-			return lua_equal(state_, -1, -2) != 0 || lua_lessthan(state_, -1, -2) != 0;
-#endif
-		}
+		KAGUYA_DECL bool operator==(const LuaRef& other)const;
+		KAGUYA_DECL bool operator<(const LuaRef& other)const;
+		KAGUYA_DECL bool operator<=(const LuaRef& other)const;
 		bool operator>=(const LuaRef& other)const
 		{
 			return other <= *this;
@@ -751,42 +671,31 @@ namespace kaguya
 	template<typename T>
 	bool operator == (const LuaRef& lhs, const T& rhs)
 	{
-		try
-		{
-			return lhs.get<const T&>() == rhs;
-		}
-		catch (const LuaTypeMismatch&)
-		{
-			return false;
-		}
-		return false;
+		optional<typename optional_detail::result_type<const T&>::type> value = lhs.tryGet<const T&>();
+		return value && *value == rhs;
 	}
 	template<typename T>
 	bool operator != (const LuaRef& lhs, const T& rhs)
 	{
 		return !(lhs == rhs);
 	}
-	inline 	bool operator == (const LuaRef& lhs, const char* rhs) { return lhs.get<std::string>() == rhs; }
+	inline 	bool operator == (const LuaRef& lhs, const char* rhs)
+	{
+		optional<std::string> value = lhs.tryGet<std::string>();
+		return value && *value == rhs;
+	}
 
 	template<typename T>
 	bool operator == (const T& lhs, const LuaRef& rhs)
 	{
-		try
-		{
-			return lhs == rhs.get<const T&>();
-		}
-		catch (const LuaTypeMismatch&)
-		{
-			return false;
-		}
-		return false;
+		return rhs == lhs;
 	}
 	template<typename T>
 	bool operator != (const T& lhs, const LuaRef& rhs)
 	{
 		return !(lhs == rhs);
 	}
-	inline bool operator == (const char* lhs, const LuaRef& rhs) { return lhs == rhs.get<std::string>(); }
+	inline bool operator == (const char* lhs, const LuaRef& rhs) { return rhs == lhs; }
 
 
 	namespace types
@@ -914,4 +823,7 @@ namespace std
 		a.swap(b);
 	}
 }
-#endif
\ No newline at end of file
+#endif
+#if KAGUYA_COMPILE_IMPL
+#include "kaguya/impl/lua_ref.inl"
+#endif
@@ -0,0 +1,224 @@
+//memory mapped file loading. not included by kaguya/kaguya.hpp because this includes platform headers(windows.h)
+#pragma once
+
+#include <cstring>
+
+#include "kaguya/config.hpp"
+#include "kaguya/state.hpp"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#define KAGUYA_UNDEF_WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#define KAGUYA_UNDEF_NOMINMAX
+#endif
+#include <windows.h>
+#ifdef KAGUYA_UNDEF_WIN32_LEAN_AND_MEAN
+#undef WIN32_LEAN_AND_MEAN
+#undef KAGUYA_UNDEF_WIN32_LEAN_AND_MEAN
+#endif
+#ifdef KAGUYA_UNDEF_NOMINMAX
+#undef NOMINMAX
+#undef KAGUYA_UNDEF_NOMINMAX
+#endif
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace kaguya
+{
+	namespace util
+	{
+		/**
+		* Read only memory mapped file.
+		* isOpen() is false for empty file or non regular file.
+		* Contents must not be truncated by other process while mapped.
+		*/
+		class MappedFile
+		{
+		public:
+			explicit MappedFile(const char* path) :data_(0), size_(0)
+#ifdef _WIN32
+				, file_(INVALID_HANDLE_VALUE), mapping_(0)
+#endif
+			{
+				open(path);
+			}
+			~MappedFile()
+			{
+				close();
+			}
+
+			bool isOpen()const { return data_ != 0; }
+			const char* data()const { return data_; }
+			size_t size()const { return size_; }
+		private:
+			//non copyable
+			MappedFile(const MappedFile&);
+			MappedFile& operator =(const MappedFile&);
+
+#ifdef _WIN32
+			void open(const char* path)
+			{
+				file_ = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+				if (file_ == INVALID_HANDLE_VALUE)
+				{
+					return;
+				}
+				LARGE_INTEGER size;
+				if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0 || static_cast<unsigned long long>(size.QuadPart) > size_t(-1))
+				{
+					close();
+					return;
+				}
+				mapping_ = CreateFileMappingA(file_, 0, PAGE_READONLY, 0, 0, 0);
+				if (!mapping_)
+				{
+					close();
+					return;
+				}
+				data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+				if (data_)
+				{
+					size_ = static_cast<size_t>(size.QuadPart);
+				}
+				else
+				{
+					close();
+				}
+			}
+			void close()
+			{
+				if (data_) { UnmapViewOfFile(data_); }
+				if (mapping_) { CloseHandle(mapping_); }
+				if (file_ != INVALID_HANDLE_VALUE) { CloseHandle(file_); }
+				data_ = 0;
+				size_ = 0;
+				mapping_ = 0;
+				file_ = INVALID_HANDLE_VALUE;
+			}
+
+			HANDLE file_;
+			HANDLE mapping_;
+#else
+			void open(const char* path)
+			{
+				int fd = ::open(path, O_RDONLY);
+				if (fd < 0)
+				{
+					return;
+				}
+				struct stat st;
+				if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+				{
+					void* addr = ::mmap(0, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+					if (addr != MAP_FAILED)
+					{
+#ifdef MADV_SEQUENTIAL
+						::madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+#endif
+						data_ = static_cast<const char*>(addr);
+						size_ = static_cast<size_t>(st.st_size);
+					}
+				}
+				::close(fd);//mapping is kept after close
+			}
+			void close()
+			{
+				if (data_)
+				{
+					::munmap(const_cast<char*>(data_), size_);
+				}
+				data_ = 0;
+				size_ = 0;
+			}
+#endif
+			const char* data_;
+			size_t size_;
+		};
+
+		//! lua_Reader that passes whole buffer at once without copy
+		struct BufferReader
+		{
+			BufferReader(const char* data, size_t size) :data_(data), size_(size) {}
+			static const char* read(lua_State*, void* ud, size_t* size)
+			{
+				BufferReader* self = static_cast<BufferReader*>(ud);
+				*size = self->size_;
+				self->size_ = 0;
+				return *size ? self->data_ : 0;
+			}
+			const char* data_;
+			size_t size_;
+		};
+
+		/**
+		* @brief load buffer by lua_load without copy.
+		* @param mode "b","t" or null(both). ignored on Lua5.1
+		*/
+		inline int loadBuffer(lua_State* state, const char* data, size_t size, const char* chunkname, const char* mode = 0)
+		{
+			BufferReader reader(data, size);
+#if LUA_VERSION_NUM >= 502
+			return lua_load(state, &BufferReader::read, &reader, chunkname, mode);
+#else
+			return lua_load(state, &BufferReader::read, &reader, chunkname);
+#endif
+		}
+
+		/**
+		* @brief load file as Lua function from memory mapped file. same result as luaL_loadfile.
+		* UTF-8 BOM and first line starting with '#' are skipped.
+		* If file can not be mapped, use luaL_loadfile.
+		*/
+		inline int loadMappedFile(lua_State* state, const char* path)
+		{
+			MappedFile file(path);
+			if (!file.isOpen())
+			{
+				return luaL_loadfile(state, path);
+			}
+			const char* data = file.data();
+			size_t size = file.size();
+			if (size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+			{
+				data += 3;
+				size -= 3;
+			}
+			if (size > 0 && data[0] == '#')
+			{//skip until newline. newline is kept for line number
+				while (size > 0 && *data != '\n')
+				{
+					++data;
+					--size;
+				}
+			}
+			lua_pushfstring(state, "@%s", path);
+			int status = loadBuffer(state, data, size, lua_tostring(state, -1));
+			lua_remove(state, -2);//chunkname
+			return status;
+		}
+	}
+
+	/**
+	* @brief FileLoader that loads script files through memory mapping.
+	* @code
+	* state.setFileLoader(kaguya::standard::shared_ptr<kaguya::FileLoader>(new kaguya::MappedFileLoader()));
+	* @endcode
+	*/
+	class MappedFileLoader : public FileLoader
+	{
+	public:
+		virtual int load(lua_State* state, const char* path)
+		{
+			return util::loadMappedFile(state, path);
+		}
+	};
+}
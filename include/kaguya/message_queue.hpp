@@ -0,0 +1,233 @@
+#pragma once
+
+#include "kaguya/config.hpp"
+
+#if KAGUYA_USE_CPP11
+#include <string>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <exception>
+
+#include "kaguya/state.hpp"
+#include "kaguya/utility.hpp"
+#include "kaguya/error_handler.hpp"
+#include "kaguya/lua_ref_function.hpp"
+#include "kaguya/serializer.hpp"
+
+namespace kaguya
+{
+	/**
+	* Lock free multi producer single consumer queue of messages to State.
+	* Any thread can post serialized value or C++ closure, and owner thread of State delivers them by drain.
+	* (intrusive MPSC queue by Dmitry Vyukov)
+	* Userdata hooks of serializer() must be registered before posting.
+	* @code
+	* kaguya::MessageQueue queue;
+	* //producer thread
+	* queue.post([](lua_State* l) { ... });
+	* //owner thread
+	* kaguya::drainMessages(state, queue, state["on_message"]);
+	* @endcode
+	*/
+	class MessageQueue
+	{
+	public:
+		typedef std::function<void(lua_State*)> closure_type;
+
+		MessageQueue() :head_(&stub_), tail_(&stub_), size_(0)
+		{
+			stub_.next.store(0, std::memory_order_relaxed);
+		}
+		~MessageQueue()
+		{
+			while (Node* node = pop())
+			{
+				delete node;
+			}
+		}
+
+		//! post data encoded by serializer(). callable from any thread
+		void post(std::string serialized)
+		{
+			Node* node = new Node();
+			node->data.swap(serialized);
+			push(node);
+		}
+		//! post closure called with lua_State* of draining State. callable from any thread
+		void post(closure_type closure)
+		{
+			Node* node = new Node();
+			node->closure.swap(closure);
+			push(node);
+		}
+		/**
+		* @brief serialize value and post. Call on thread that owns value.
+		* @return false if value is not serializable
+		*/
+		bool postValue(const LuaRef& value)
+		{
+			std::string data;
+			if (!serializer_.serialize(value, data))
+			{
+				return false;
+			}
+			post(std::move(data));
+			return true;
+		}
+
+		/**
+		* @brief deliver messages on owner thread.
+		* Serialized message is decoded and passed to handler. Closure is called.
+		* Handler and closure are called in protected mode. Lua error and C++ exception are sent to error handler and draining continues.
+		* @param state lua state
+		* @param handler Lua function receiving one message
+		* @param max_count max number of messages in this call. 0 is all messages
+		* @return number of delivered messages
+		*/
+		size_t drain(lua_State* state, const LuaRef& handler, size_t max_count = 0)
+		{
+			size_t count = 0;
+			while (max_count == 0 || count < max_count)
+			{
+				std::unique_ptr<Node> node(pop());
+				if (!node)
+				{
+					break;
+				}
+				count++;
+				util::ScopedSavedStack save(state);
+				if (node->closure)
+				{
+					lua_pushcfunction(state, &call_closure);
+					lua_pushlightuserdata(state, &node->closure);
+					int status = lua_pcall(state, 1, 0, 0);
+					if (status)
+					{
+						ErrorHandler::instance().handle(status, state);
+					}
+					continue;
+				}
+				handler.push(state);
+				if (!serializer_.deserializeToStack(state, node->data.data(), node->data.size()))
+				{
+					continue;
+				}
+				int status = lua_pcall(state, 1, 0, 0);
+				if (status)
+				{
+					ErrorHandler::instance().handle(status, state);
+				}
+			}
+			return count;
+		}
+
+		//! approximate number of queued messages
+		size_t size()const { return size_.load(std::memory_order_relaxed); }
+		bool empty()const { return size() == 0; }
+
+		//! serializer for postValue and drain. setup hooks before use
+		Serializer& serializer() { return serializer_; }
+	private:
+		//non copyable
+		MessageQueue(const MessageQueue&);
+		MessageQueue& operator =(const MessageQueue&);
+
+		struct Node
+		{
+			std::atomic<Node*> next;
+			std::string data;
+			closure_type closure;
+		};
+
+		//closure_type* at index 1
+		static int call_closure(lua_State* state)
+		{
+			closure_type* closure = static_cast<closure_type*>(lua_touserdata(state, 1));
+			lua_remove(state, 1);
+			try
+			{
+				(*closure)(state);
+				return 0;
+			}
+			catch (std::exception& e)
+			{
+				util::traceBack(state, e.what());
+			}
+			catch (...)
+			{
+				util::traceBack(state, "Unknown exception");
+			}
+			return lua_error(state);
+		}
+
+		void push(Node* node)
+		{
+			size_.fetch_add(1, std::memory_order_relaxed);
+			link(node);
+		}
+		void link(Node* node)
+		{
+			node->next.store(0, std::memory_order_relaxed);
+			Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+			prev->next.store(node, std::memory_order_release);
+		}
+		//return node removed from queue. caller owns it
+		Node* pop()
+		{
+			Node* tail = tail_;
+			Node* next = tail->next.load(std::memory_order_acquire);
+			if (tail == &stub_)
+			{
+				if (!next)
+				{
+					return 0;
+				}
+				//skip stub
+				tail_ = next;
+				tail = next;
+				next = next->next.load(std::memory_order_acquire);
+			}
+			if (next)
+			{
+				tail_ = next;
+				size_.fetch_sub(1, std::memory_order_relaxed);
+				return tail;
+			}
+			if (tail != head_.load(std::memory_order_acquire))
+			{//producer is in progress of push
+				return 0;
+			}
+			//put stub back to take last node
+			link(&stub_);
+			next = tail->next.load(std::memory_order_acquire);
+			if (next)
+			{
+				tail_ = next;
+				size_.fetch_sub(1, std::memory_order_relaxed);
+				return tail;
+			}
+			return 0;
+		}
+
+		std::atomic<Node*> head_;
+		Node* tail_;
+		Node stub_;
+		std::atomic<size_t> size_;
+		Serializer serializer_;
+	};
+
+	/**
+	* @brief deliver messages posted to queue from other threads. call on owner thread of state.
+	* @param state receiver of messages
+	* @param queue message queue
+	* @param handler Lua function receiving one message
+	* @param max_count max number of messages in this call. 0 is all messages
+	* @return number of delivered messages
+	*/
+	inline size_t drainMessages(State& state, MessageQueue& queue, const LuaRef& handler, size_t max_count = 0)
+	{
+		return queue.drain(state.state(), handler, max_count);
+	}
+}
+#endif
@@ -3,7 +3,6 @@
 #include <string>
 #include <vector>
 #include <map>
-#include <typeinfo>
 #include <iostream>
 
 #include "kaguya/config.hpp"
@@ -95,7 +94,7 @@ namespace kaguya
 			}
 			else
 			{
-				except::OtherError(state,typeid(class_type*).name() +  std::string("is already registered"));
+				except::OtherError(state, metatableName<class_type>() + std::string("is already registered"));
 			}
 			return LuaRef(state);
 		}
@@ -208,7 +207,12 @@ namespace kaguya
 				new(storage) FunctorType(*f);
 				class_userdata::setmetatable<FunctorType>(state);
 			}
+#if KAGUYA_ENABLE_INSTRUMENTATION
+			lua_pushlightuserdata(state, instrumentation::Registry::instance().binding(util::typeName<class_type>(), name));
+			lua_pushcclosure(state, &nativefunction::instrumented_functor_dispatcher, funcnum + 2);
+#else
 			lua_pushcclosure(state, &nativefunction::functor_dispatcher, funcnum + 1);
+#endif
 			lua_setfield(state, -2, name);
 		}
 		void registerField(lua_State* state, const char* name, const ValueType& value)const
@@ -7,6 +7,9 @@
 #include "kaguya/utility.hpp"
 #include "kaguya/type.hpp"
 #include "kaguya/lua_ref.hpp"
+#if KAGUYA_ENABLE_INSTRUMENTATION
+#include "kaguya/instrumentation.hpp"
+#endif
 
 
 namespace kaguya
@@ -33,14 +36,184 @@ namespace kaguya
 			{
 			}
 
+#if KAGUYA_USE_VARIADIC_TEMPLATE
+			template<typename CLASS, typename... Args>
+			static FunctorType ConstructorInvoker()
+			{
+				return FunctorType(base_ptr_(new TypedConstructorInvoker<CLASS, Args...>()));
+			}
+#else
 #include "kaguya/gen/constructor.inl"
+#endif
 
 			template<typename CLASS>static FunctorType VariadicConstructorInvoker()
 			{
 				return FunctorType(base_ptr_(new VariadicArgConstructorInvoker<CLASS>()));
 			}
 		private:
+#if KAGUYA_USE_VARIADIC_TEMPLATE
+			template<typename T>
+			static T& as_lvalue(T&& v) { return v; }
+
+			template<typename Arg>
+			static typename traits::arg_get_type<Arg>::type get_argument(lua_State* state, int index)
+			{
+				return types::get(state, index, types::typetag<typename traits::arg_get_type<Arg>::type>());
+			}
+
+			template<int Index>
+			static bool check_arguments(lua_State*, bool)
+			{
+				return true;
+			}
+			template<int Index, typename Arg, typename... Rest>
+			static bool check_arguments(lua_State* state, bool strictcheck)
+			{
+				typedef typename traits::arg_get_type<Arg>::type arg_type;
+				if (strictcheck ? !types::strictCheckType(state, Index, types::typetag<arg_type>())
+					: !types::checkType(state, Index, types::typetag<arg_type>()))
+				{
+					return false;
+				}
+				return check_arguments<Index + 1, Rest...>(state, strictcheck);
+			}
+
+			template<typename... Args>
+			static std::string argument_type_names(std::string result = std::string())
+			{
+				const char* names[] = { util::typeName<Args>()..., 0 };
+				for (int i = 0; names[i]; ++i)
+				{
+					if (!result.empty()) { result += ","; }
+					result += names[i];
+				}
+				return result;
+			}
+
+			//function pointer and standard::function
+			template<typename Func, typename Ret, typename... Args>
+			struct FunInvoker :BaseInvoker {
+				typedef Func func_type;
+				func_type func_;
+				FunInvoker(func_type fun) :func_(fun) {}
+				virtual bool checktype(lua_State *state, bool strictcheck)
+				{
+					if (lua_gettop(state) != int(sizeof...(Args))) { return false; }
+					return check_arguments<1, Args...>(state, strictcheck);
+				}
+				virtual int invoke(lua_State *state)
+				{
+					return call(state, typename traits::make_index_tuple<sizeof...(Args)>::type(), traits::is_void<Ret>());
+				}
+				virtual std::string argumentTypeNames()
+				{
+					return argument_type_names<Args...>();
+				}
+			private:
+				template<std::size_t... Indexes>
+				int call(lua_State *state, traits::index_tuple<Indexes...>, traits::integral_constant<bool, false>)
+				{
+					Ret r = func_(as_lvalue(get_argument<Args>(state, int(Indexes) + 1))...);
+					return types::push_dispatch(state, standard::forward<Ret>(r));
+				}
+				template<std::size_t... Indexes>
+				int call(lua_State *state, traits::index_tuple<Indexes...>, traits::integral_constant<bool, true>)
+				{
+					func_(as_lvalue(get_argument<Args>(state, int(Indexes) + 1))...);
+					return 0;
+				}
+			};
+			template<typename Ret, typename... Args>
+			base_ptr_ create(Ret(*fun)(Args...))
+			{
+				typedef FunInvoker<Ret(*)(Args...), Ret, Args...> invoker_type;
+				return base_ptr_(new invoker_type(fun));
+			}
+			template<typename Ret, typename... Args>
+			base_ptr_ create(standard::function<Ret(Args...)> fun)
+			{
+				typedef FunInvoker<standard::function<Ret(Args...)>, Ret, Args...> invoker_type;
+				return base_ptr_(new invoker_type(fun));
+			}
+
+			//member function. ClassType is const for const member function
+			template<typename Func, typename Ret, typename ClassType, typename... Args>
+			struct MemFunInvoker :BaseInvoker {
+				typedef Func func_type;
+				func_type func_;
+				MemFunInvoker(func_type fun) :func_(fun) {}
+				virtual bool checktype(lua_State *state, bool strictcheck)
+				{
+					if (lua_gettop(state) != int(sizeof...(Args)) + 1) { return false; }
+					if (types::get(state, 1, types::typetag<ClassType*>()) == 0) { return false; }
+					return check_arguments<2, Args...>(state, strictcheck);
+				}
+				virtual int invoke(lua_State *state)
+				{
+					ClassType* ptr = types::get(state, 1, types::typetag<ClassType*>());
+					if (!ptr) { return 0; }
+					return call(state, ptr, typename traits::make_index_tuple<sizeof...(Args)>::type(), traits::is_void<Ret>());
+				}
+				virtual std::string argumentTypeNames()
+				{
+					return argument_type_names<Args...>(util::typeName<ClassType>());
+				}
+			private:
+				template<std::size_t... Indexes>
+				int call(lua_State *state, ClassType* ptr, traits::index_tuple<Indexes...>, traits::integral_constant<bool, false>)
+				{
+					Ret r = (ptr->*func_)(as_lvalue(get_argument<Args>(state, int(Indexes) + 2))...);
+					return types::push_dispatch(state, standard::forward<Ret>(r));
+				}
+				template<std::size_t... Indexes>
+				int call(lua_State *state, ClassType* ptr, traits::index_tuple<Indexes...>, traits::integral_constant<bool, true>)
+				{
+					(ptr->*func_)(as_lvalue(get_argument<Args>(state, int(Indexes) + 2))...);
+					return 0;
+				}
+			};
+			template<typename Ret, typename T, typename... Args>
+			base_ptr_ create(Ret(T::*fun)(Args...))
+			{
+				typedef MemFunInvoker<Ret(T::*)(Args...), Ret, T, Args...> invoker_type;
+				return base_ptr_(new invoker_type(fun));
+			}
+			template<typename Ret, typename T, typename... Args>
+			base_ptr_ create(Ret(T::*fun)(Args...)const)
+			{
+				typedef MemFunInvoker<Ret(T::*)(Args...)const, Ret, const T, Args...> invoker_type;
+				return base_ptr_(new invoker_type(fun));
+			}
+
+			template<typename CLASS, typename... Args>
+			struct TypedConstructorInvoker :BaseInvoker {
+				virtual bool checktype(lua_State *state, bool strictcheck)
+				{
+					if (lua_gettop(state) != int(sizeof...(Args))) { return false; }
+					return check_arguments<1, Args...>(state, strictcheck);
+				}
+				virtual int invoke(lua_State *state)
+				{
+					return construct(state, typename traits::make_index_tuple<sizeof...(Args)>::type());
+				}
+				virtual std::string argumentTypeNames()
+				{
+					return argument_type_names<Args...>();
+				}
+			private:
+				template<std::size_t... Indexes>
+				int construct(lua_State *state, traits::index_tuple<Indexes...>)
+				{
+					typedef ObjectWrapper<CLASS> wrapper_type;
+					void *storage = lua_newuserdata(state, sizeof(wrapper_type));
+					new(storage) wrapper_type(as_lvalue(get_argument<Args>(state, int(Indexes) + 1))...);
+					class_userdata::setmetatable<CLASS>(state);
+					return 1;
+				}
+			};
+#else
 #include "kaguya/gen/native_function.inl"
+#endif
 
 			template<class ClassType, class MemType>
 			struct MemDataInvoker :BaseInvoker {
@@ -68,8 +241,8 @@ namespace kaguya
 
 				virtual std::string argumentTypeNames() {
 					std::string result;
-					result += typeid(ClassType).name();
-					result += std::string("[opt]") + typeid(MemType).name();
+					result += util::typeName<ClassType>();
+					result += std::string("[opt]") + util::typeName<MemType>();
 					return result;
 				}
 			};
@@ -181,7 +354,7 @@ namespace kaguya
 
 				virtual std::string argumentTypeNames() {
 					std::string result;
-					result += typeid(T).name();
+					result += util::typeName<T>();
 					result += ",VariadicArg";
 					return result;
 				}
@@ -217,7 +390,7 @@ namespace kaguya
 				}
 				virtual std::string argumentTypeNames() {
 					std::string result;
-					result += typeid(T).name();
+					result += util::typeName<T>();
 					result += ",VariadicArg";
 					return result;
 				}
@@ -254,7 +427,7 @@ namespace kaguya
 				}
 				virtual std::string argumentTypeNames() {
 					std::string result;
-					result += typeid(T).name();
+					result += util::typeName<T>();
 					result += ",VariadicArg";
 					return result;
 				}
@@ -289,7 +462,7 @@ namespace kaguya
 				}
 				virtual std::string argumentTypeNames() {
 					std::string result;
-					result += typeid(T).name();
+					result += util::typeName<T>();
 					result += ",VariadicArg";
 					return result;
 				}
@@ -454,6 +627,38 @@ namespace kaguya
 			}
 			return lua_error(l);
 		}
+#if KAGUYA_ENABLE_INSTRUMENTATION
+		//functor_dispatcher with instrumentation::BindingStats* as last upvalue
+		inline int instrumented_functor_dispatcher(lua_State *l)
+		{
+			int overloadnum = int(lua_tonumber(l, lua_upvalueindex(1)));
+			instrumentation::BindingStats* stats = static_cast<instrumentation::BindingStats*>(lua_touserdata(l, lua_upvalueindex(overloadnum + 2)));
+			FunctorType* fun = pick_match_function(l);
+			if (fun && (*fun))
+			{
+				unsigned long long start = instrumentation::now_ns();
+				try {
+					int result = (*fun)->invoke(l);
+					stats->recordCall(instrumentation::now_ns() - start);
+					return result;
+				}
+				catch (std::exception & e) {
+					stats->recordException();
+					util::traceBack(l, e.what());
+				}
+				catch (...) {
+					stats->recordException();
+					util::traceBack(l, "Unknown exception");
+				}
+			}
+			else
+			{
+				stats->recordOverloadFailure();
+				util::traceBack(l, build_arg_error_message(l).c_str());
+			}
+			return lua_error(l);
+		}
+#endif
 
 		inline int functor_destructor(lua_State *state)
 		{
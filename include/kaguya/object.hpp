@@ -2,7 +2,6 @@
 
 #include <string>
 #include <cstring>
-#include <typeinfo>
 
 #include "kaguya/config.hpp"
 #include "kaguya/traits.hpp"
@@ -11,6 +10,86 @@
 namespace kaguya
 {
 #define KAGUYA_METATABLE_PREFIX "kaguya_object_type_"
+
+	namespace type_name_detail
+	{
+		//copy type part of compiler generated function signature after prefix. buffer size is greater than signature
+		inline const char* extract(const char* signature, char* buffer)
+		{
+#if defined(_MSC_VER)
+			const char* begin_marker = "type_name<";
+			const char* end_marker = ">::get(";
+#else
+			const char* begin_marker = "T = ";
+			const char* end_marker = "]";
+#endif
+			const char* begin = std::strstr(signature, begin_marker);
+			const char* end = 0;
+			if (begin)
+			{
+				begin += std::strlen(begin_marker);
+				for (const char* p = std::strstr(begin, end_marker); p; p = std::strstr(p + 1, end_marker))
+				{
+					end = p;
+				}
+			}
+			if (!begin || !end)
+			{
+				begin = signature;
+				end = signature + std::strlen(signature);
+			}
+#if defined(_MSC_VER)
+			if (std::strncmp(begin, "class ", 6) == 0) { begin += 6; }
+			else if (std::strncmp(begin, "struct ", 7) == 0) { begin += 7; }
+#endif
+			size_t prefix_length = std::strlen(KAGUYA_METATABLE_PREFIX);
+			std::memcpy(buffer, KAGUYA_METATABLE_PREFIX, prefix_length);
+			std::memcpy(buffer + prefix_length, begin, end - begin);
+			buffer[prefix_length + (end - begin)] = '\0';
+			return buffer;
+		}
+	}
+#if defined(_MSC_VER)
+#define KAGUYA_FUNCTION_SIGNATURE __FUNCSIG__
+#else
+#define KAGUYA_FUNCTION_SIGNATURE __PRETTY_FUNCTION__
+#endif
+
+	/**
+	* @brief metatable name of T without RTTI. "kaguya_object_type_" + type name.
+	* Name is taken from compiler generated function signature and copied to static buffer on first call.
+	* Specialize by KAGUYA_TYPE_NAME for a fixed name.
+	*/
+	template<typename T>
+	struct type_name
+	{
+		static const char* get()
+		{
+			static char buffer[sizeof(KAGUYA_FUNCTION_SIGNATURE) + sizeof(KAGUYA_METATABLE_PREFIX)];
+			static const char* name = type_name_detail::extract(KAGUYA_FUNCTION_SIGNATURE, buffer);
+			return name;
+		}
+	};
+
+	/**
+	* @brief give type a compile time name. use in global namespace before the type is used with kaguya.
+	* @code
+	* KAGUYA_TYPE_NAME(game::Vec3, "Vec3")
+	* @endcode
+	*/
+#define KAGUYA_TYPE_NAME(TYPE, NAME) \
+	namespace kaguya { template<> struct type_name<TYPE> { static const char* get() { return KAGUYA_METATABLE_PREFIX NAME; } }; }
+
+	namespace util
+	{
+		//! readable type name of T. does not require RTTI
+		template<typename T>
+		inline const char* typeName()
+		{
+			return type_name<T>::get() + sizeof(KAGUYA_METATABLE_PREFIX) - 1;
+		}
+	}
+
 	template<typename T>
 	inline const std::string& metatableName()
 	{
@@ -18,24 +97,56 @@ namespace kaguya
 		typedef typename traits::remove_pointer<noncv_type>::type noncvpointer_type;
 		typedef typename traits::remove_const_and_reference<noncvpointer_type>::type noncvpointerref_type;
 
-		static const std::string v = std::string(KAGUYA_METATABLE_PREFIX) + typeid(noncvpointerref_type*).name();
-
+		static const std::string v = type_name<noncvpointerref_type>::get();
 		return v;
 	}
+
+	namespace type_name_detail
+	{
+		template<typename T>
+		struct identity
+		{
+			static char key;
+		};
+		template<typename T>
+		char identity<T>::key = 0;
+	}
+	//! identity of bound type. not convertible from metatable name or other pointers
+	struct TypeKey
+	{
+		const void* address;//null is no type
+
+		bool operator==(const TypeKey& other)const { return address == other.address; }
+		bool operator!=(const TypeKey& other)const { return address != other.address; }
+	};
+
+	//! unique key of T. registry key of metatable
 	template<typename T>
-	const std::type_info* metatableType()
+	TypeKey metatableType()
 	{
 		typedef typename traits::remove_cv<T>::type noncv_type;
 		typedef typename traits::remove_pointer<noncv_type>::type noncvpointer_type;
 		typedef typename traits::remove_const_and_reference<noncvpointer_type>::type noncvpointerref_type;
-		return &typeid(noncvpointerref_type*);
+		TypeKey key = { &type_name_detail::identity<noncvpointerref_type>::key };
+		return key;
+	}
+
+	//! push metatable registered by type key. push nil if not registered
+	inline void get_metatable(lua_State* l, TypeKey type)
+	{
+#if LUA_VERSION_NUM >= 502
+		lua_rawgetp(l, LUA_REGISTRYINDEX, type.address);
+#else
+		lua_pushlightuserdata(l, const_cast<void*>(type.address));
+		lua_rawget(l, LUA_REGISTRYINDEX);
+#endif
 	}
 
 	namespace class_userdata
 	{
 		template<typename T>bool get_metatable(lua_State* l)
 		{
-			luaL_getmetatable(l, metatableName<T>().c_str());
+			kaguya::get_metatable(l, metatableType<T>());
 			return LUA_TNIL != lua_type(l, -1);
 		}
 		template<typename T>bool available_metatable(lua_State* l)
@@ -43,26 +154,49 @@ namespace kaguya
 			util::ScopedSavedStack save(l);
 			return get_metatable<T>(l);
 		}
+		//metatable is registered by type key and by name(for luaL_getmetatable)
 		template<typename T>bool newmetatable(lua_State* l)
 		{
-			if (luaL_newmetatable(l, metatableName<T>().c_str()))
+			if (get_metatable<T>(l))
 			{
-#if LUA_VERSION_NUM < 503
-				lua_pushstring(l, metatableName<T>().c_str());
-				lua_setfield(l, -2, "__name");
-#endif
-				return true;
+				return false;
 			}
-			return false;
+			lua_pop(l, 1);
+			lua_newtable(l);
+			lua_pushstring(l, metatableName<T>().c_str());
+			lua_setfield(l, -2, "__name");
+			lua_pushvalue(l, -1);
+			lua_setfield(l, LUA_REGISTRYINDEX, metatableName<T>().c_str());
+#if LUA_VERSION_NUM >= 502
+			lua_pushvalue(l, -1);
+			lua_rawsetp(l, LUA_REGISTRYINDEX, metatableType<T>().address);
+#else
+			lua_pushlightuserdata(l, const_cast<void*>(metatableType<T>().address));
+			lua_pushvalue(l, -2);
+			lua_rawset(l, LUA_REGISTRYINDEX);
+#endif
+			return true;
 		}
 		template<typename T>void setmetatable(lua_State* l)
 		{
-			return luaL_setmetatable(l, metatableName<T>().c_str());
+			get_metatable<T>(l);
+			lua_setmetatable(l, -2);
 		}
 
 		template<typename T>T* test_userdata(lua_State* l, int index)
 		{
-			return static_cast<T*>(luaL_testudata(l, index, metatableName<T>().c_str()));
+			void* p = lua_touserdata(l, index);
+			if (!p || !lua_getmetatable(l, index))
+			{
+				return 0;
+			}
+			get_metatable<T>(l);
+			if (!lua_rawequal(l, -1, -2))
+			{
+				p = 0;
+			}
+			lua_pop(l, 2);
+			return static_cast<T*>(p);
 		}
 
 		template<typename T>inline void destructor(T* pointer)
@@ -88,7 +222,7 @@ namespace kaguya
 
 	struct ObjectWrapperBase
 	{
-		virtual bool is_native_type(const std::string& type) = 0;
+		virtual bool is_native_type(TypeKey type) = 0;
 
 		virtual const void* native_cget() = 0;
 		virtual void* native_get() = 0;
@@ -128,9 +262,9 @@ namespace kaguya
 		ObjectWrapper(Args&&... args) : object(standard::forward<Args>(args)...) {}
 #endif
 
-		virtual bool is_native_type(const std::string& type)
+		virtual bool is_native_type(TypeKey type)
 		{
-			return metatableName<T>() == type;
+			return metatableType<T>() == type;
 		}
 
 		virtual void* get()
@@ -152,9 +286,9 @@ namespace kaguya
 
 		ObjectSmartPointerWrapper(const T& sptr) :object(sptr) {}
 
-		virtual bool is_native_type(const std::string& type)
+		virtual bool is_native_type(TypeKey type)
 		{
-			return metatableName<T >() == type;
+			return metatableType<T>() == type;
 		}
 		virtual void* get()
 		{
@@ -175,9 +309,9 @@ namespace kaguya
 
 		ObjectPointerWrapper(T* ptr) :object(ptr) {}
 
-		virtual bool is_native_type(const std::string& type)
+		virtual bool is_native_type(TypeKey type)
 		{
-			return metatableName<T>() == type;
+			return metatableType<T>() == type;
 		}
 		virtual void* get()
 		{
@@ -195,35 +329,45 @@ namespace kaguya
 		virtual void* native_get() { return get(); };
 	};
 
-	inline bool recursive_base_type_check(lua_State* l, int index, const std::string& require_type)
+	//! true if metatable of value at index or its base class metatable is registered by require_type
+	inline bool recursive_base_type_check(lua_State* l, int index, TypeKey require_type)
 	{
-		if (lua_getmetatable(l, index))
+		util::ScopedSavedStack save(l);
+		index = lua_absindex(l, index);
+		get_metatable(l, require_type);
+		if (lua_type(l, -1) != LUA_TTABLE)
+		{
+			return false;
+		}
+		int required = lua_gettop(l);
+		if (!lua_getmetatable(l, index))
 		{
-			lua_getfield(l, -1, "__name");
-			const char* metatable_name = lua_tostring(l, -1);
-			if (metatable_name)
+			return false;
+		}
+		for (;;)
+		{
+			if (lua_rawequal(l, -1, required))
 			{
-				if (require_type == metatable_name)
-				{
-					return true;
-				}
-				return recursive_base_type_check(l,-2, require_type);
+				return true;
 			}
+			if (!lua_getmetatable(l, -1))
+			{
+				return false;
+			}
+			lua_remove(l, -2);
 		}
-		return false;	
 	}
 
-	inline ObjectWrapperBase* object_wrapper(lua_State* l, int index,const std::string& require_type= std::string())
+	inline ObjectWrapperBase* object_wrapper(lua_State* l, int index, TypeKey require_type = TypeKey())
 	{
-		util::ScopedSavedStack save(l);
 		void* ptr = lua_touserdata(l, index);
 		if (ptr && lua_type(l, index) == LUA_TUSERDATA)
 		{
-			if (static_cast<ObjectWrapperBase*>(ptr)->is_native_type(require_type))
+			if (!require_type.address || static_cast<ObjectWrapperBase*>(ptr)->is_native_type(require_type))
 			{
 				return static_cast<ObjectWrapperBase*>(ptr);
 			}
-			else if (require_type.empty() || recursive_base_type_check(l,index, require_type))
+			else if (recursive_base_type_check(l, index, require_type))
 			{
 				return static_cast<ObjectWrapperBase*>(ptr);
 			}
@@ -245,10 +389,10 @@ namespace kaguya
 		}
 		else
 		{
-			ObjectWrapperBase* objwrapper = object_wrapper(l, index,metatableName<T>());
+			ObjectWrapperBase* objwrapper = object_wrapper(l, index, metatableType<T>());
 			if (objwrapper)
 			{
-				if (static_cast<ObjectWrapperBase*>(objwrapper)->is_native_type(metatableName<T>()))
+				if (static_cast<ObjectWrapperBase*>(objwrapper)->is_native_type(metatableType<T>()))
 				{
 					return static_cast<T*>(objwrapper->native_get());
 				}
@@ -275,10 +419,10 @@ namespace kaguya
 		}
 		else
 		{
-			ObjectWrapperBase* objwrapper = object_wrapper(l, index, metatableName<T>());
+			ObjectWrapperBase* objwrapper = object_wrapper(l, index, metatableType<T>());
 			if (objwrapper)
 			{
-				if (static_cast<ObjectWrapperBase*>(objwrapper)->is_native_type(metatableName<T>()))
+				if (static_cast<ObjectWrapperBase*>(objwrapper)->is_native_type(metatableType<T>()))
 				{
 					return static_cast<const T*>(objwrapper->native_cget());
 				}
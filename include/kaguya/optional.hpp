@@ -0,0 +1,132 @@
+#pragma once
+
+#include <new>
+
+#include "kaguya/config.hpp"
+#include "kaguya/exception.hpp"
+
+namespace kaguya
+{
+	/**
+	* @brief value or nothing. result of LuaRef::tryGet.
+	* Subset of std::optional interface usable in C++03.
+	*/
+	template<typename T>
+	class optional
+	{
+	public:
+		optional() :has_value_(false) {}
+		optional(const T& value) :has_value_(true)
+		{
+			new(storage()) T(value);
+		}
+		optional(const optional& other) :has_value_(other.has_value_)
+		{
+			if (has_value_)
+			{
+				new(storage()) T(*other);
+			}
+		}
+		optional& operator=(const optional& other)
+		{
+			if (this != &other)
+			{
+				reset();
+				if (other.has_value_)
+				{
+					new(storage()) T(*other);
+					has_value_ = true;
+				}
+			}
+			return *this;
+		}
+		~optional()
+		{
+			reset();
+		}
+
+		bool has_value()const { return has_value_; }
+#if KAGUYA_USE_CPP11
+		explicit operator bool()const { return has_value_; }
+#else
+		typedef bool (optional::*safe_bool_type)()const;
+		operator safe_bool_type()const { return has_value_ ? &optional::has_value : 0; }
+#endif
+
+		const T& operator*()const { return *static_cast<const T*>(storage()); }
+		T& operator*() { return *static_cast<T*>(storage()); }
+		const T* operator->()const { return static_cast<const T*>(storage()); }
+		T* operator->() { return static_cast<T*>(storage()); }
+
+		//! throw LuaTypeMismatch if empty
+		const T& value()const
+		{
+			if (!has_value_) { throw LuaTypeMismatch("optional has no value"); }
+			return **this;
+		}
+		T value_or(const T& default_value)const
+		{
+			return has_value_ ? **this : default_value;
+		}
+
+		void reset()
+		{
+			if (has_value_)
+			{
+				static_cast<T*>(storage())->~T();
+				has_value_ = false;
+			}
+		}
+	private:
+		void* storage() { return &storage_; }
+		const void* storage()const { return &storage_; }
+
+#if KAGUYA_USE_CPP11 && (!defined(_MSC_VER) || _MSC_VER >= 1900)//alignof is not supported before VS2015
+		typename standard::aligned_storage<sizeof(T), alignof(T)>::type storage_;
+#else
+		union
+		{
+			char buffer[sizeof(T)];
+			long double align_double;
+			long long align_integer;
+			void* align_pointer;
+		} storage_;
+#endif
+		bool has_value_;
+	};
+
+	//! reference to object held by Lua or nothing
+	template<typename T>
+	class optional<T&>
+	{
+	public:
+		optional() :pointer_(0) {}
+		optional(T& value) :pointer_(&value) {}
+
+		bool has_value()const { return pointer_ != 0; }
+#if KAGUYA_USE_CPP11
+		explicit operator bool()const { return pointer_ != 0; }
+#else
+		typedef bool (optional::*safe_bool_type)()const;
+		operator safe_bool_type()const { return pointer_ ? &optional::has_value : 0; }
+#endif
+
+		T& operator*()const { return *pointer_; }
+		T* operator->()const { return pointer_; }
+
+		//! throw LuaTypeMismatch if empty
+		T& value()const
+		{
+			if (!pointer_) { throw LuaTypeMismatch("optional has no value"); }
+			return *pointer_;
+		}
+		T& value_or(T& default_value)const
+		{
+			return pointer_ ? *pointer_ : default_value;
+		}
+
+		void reset() { pointer_ = 0; }
+	private:
+		T* pointer_;
+	};
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <cstdio>
+
+#include "kaguya/config.hpp"
+
+#if KAGUYA_USE_CPP11
+#include <atomic>
+#endif
+
+namespace kaguya
+{
+	/**
+	* Sampling profiler for Lua code.
+	* Call stack is sampled by count hook every sample_interval instructions.
+	* In timer mode, stack is sampled only when requestSample() was called (e.g. from timer thread)
+	* and the flag is checked every sample_interval instructions.
+	* Output is collapsed stack format for flamegraph.pl.
+	* Profiler uses Lua hook. Do not use with other hook (e.g. ScopedExecutionBudget) at the same time.
+	*
+	* Limitations:
+	* - Count hook runs only on Lua instructions. Time spent in bound C++ functions is not sampled;
+	*   in timer mode it is charged to the Lua code that runs after the call.
+	*   C++ frames appear only when they call back into Lua.
+	*   Use call instrumentation (kaguya/instrumentation.hpp) for time spent in bound functions.
+	* - Hook is set on the thread of state given to constructor. Coroutines created from it after start()
+	*   inherit the hook, but coroutines created before start() are not sampled.
+	* @code
+	* kaguya::Profiler profiler(state.state());
+	* profiler.start();
+	* state("run()");
+	* profiler.stop();
+	* profiler.writeCollapsed(std::cout);
+	* @endcode
+	*/
+	class Profiler
+	{
+	public:
+		/**
+		* @param state lua state
+		* @param sample_interval instructions between samples (or flag checks in timer mode)
+		* @param max_depth max number of frames in a sample. deeper frames are folded to "..."
+		*/
+		explicit Profiler(lua_State* state, int sample_interval = 1000, int max_depth = 64)
+			:state_(state), interval_(sample_interval > 0 ? sample_interval : 1), max_depth_(max_depth > 0 ? max_depth : 1)
+			, running_(false), timer_mode_(false), sample_requested_(false), sample_count_(0)
+			, prev_hook_(0), prev_mask_(0), prev_count_(0)
+		{
+		}
+		~Profiler()
+		{
+			stop();
+		}
+
+		//! start sampling. previous hook is saved and restored by stop()
+		void start()
+		{
+			if (running_)
+			{
+				return;
+			}
+			prev_hook_ = lua_gethook(state_);
+			prev_mask_ = lua_gethookmask(state_);
+			prev_count_ = lua_gethookcount(state_);
+			setCurrent(this);
+			lua_sethook(state_, &hook, LUA_MASKCOUNT, interval_);
+			running_ = true;
+		}
+		//! stop sampling. collected samples are kept
+		void stop()
+		{
+			if (!running_)
+			{
+				return;
+			}
+			setCurrent(0);
+			lua_sethook(state_, prev_hook_, prev_mask_, prev_count_);
+			running_ = false;
+		}
+		bool running()const { return running_; }
+
+		//! sample only when requestSample() is called
+		void setTimerMode(bool timer_mode) { timer_mode_ = timer_mode; }
+		//! request sample at next check. callable from other thread in timer mode
+		void requestSample() { sample_requested_ = true; }
+
+		//! number of samples
+		size_t sampleCount()const { return sample_count_; }
+		//! remove collected samples
+		void clear()
+		{
+			samples_.clear();
+			sample_count_ = 0;
+			std::string().swap(stack_);
+		}
+
+		//! write samples as "frame;frame;frame count" lines. root frame is first
+		void writeCollapsed(std::ostream& os)const
+		{
+			for (std::map<std::string, size_t>::const_iterator it = samples_.begin(); it != samples_.end(); ++it)
+			{
+				os << it->first << " " << it->second << "\n";
+			}
+		}
+		std::string collapsed()const
+		{
+			std::ostringstream os;
+			writeCollapsed(os);
+			return os.str();
+		}
+	private:
+		//non copyable
+		Profiler(const Profiler&);
+		Profiler& operator =(const Profiler&);
+
+		static void* key()
+		{
+			static char key;
+			return &key;
+		}
+		void setCurrent(Profiler* profiler)
+		{
+			lua_pushlightuserdata(state_, key());
+			if (profiler)
+			{
+				lua_pushlightuserdata(state_, profiler);
+			}
+			else
+			{
+				lua_pushnil(state_);
+			}
+			lua_rawset(state_, LUA_REGISTRYINDEX);
+		}
+
+		static void appendFrame(std::string& out, lua_State* l, lua_Debug& ar)
+		{
+			lua_getinfo(l, "Sn", &ar);
+			const char* name = ar.name;
+			if (!name)
+			{
+				name = (ar.what && ar.what[0] == 'm') ? "main chunk" : "?";
+			}
+			size_t start = out.size();
+			out += name;
+			if (ar.what && ar.what[0] == 'C')
+			{
+				out += " [C]";
+			}
+			else
+			{
+				char line[32];
+				std::sprintf(line, ":%d)", ar.linedefined);
+				out += " (";
+				out += ar.short_src;
+				out += line;
+			}
+			for (size_t i = start; i < out.size(); ++i)
+			{//';' is frame separator
+				if (out[i] == ';') { out[i] = ','; }
+			}
+		}
+
+		void sample(lua_State* l)
+		{
+			lua_Debug ar;
+			int depth = 0;
+			while (depth < max_depth_ && lua_getstack(l, depth, &ar))
+			{
+				++depth;
+			}
+			bool truncated = lua_getstack(l, depth, &ar) != 0;
+			std::string& stack = stack_;//reuse buffer. no allocation for already seen stack
+			stack.clear();
+			if (truncated)
+			{
+				stack += "...";
+			}
+			for (int level = depth - 1; level >= 0; --level)
+			{
+				if (!stack.empty())
+				{
+					stack += ';';
+				}
+				lua_getstack(l, level, &ar);
+				appendFrame(stack, l, ar);
+			}
+			if (!stack.empty())
+			{
+				std::map<std::string, size_t>::iterator it = samples_.find(stack);
+				if (it == samples_.end())
+				{
+					it = samples_.insert(std::make_pair(stack, size_t(0))).first;
+				}
+				it->second++;
+				sample_count_++;
+			}
+		}
+
+		static void hook(lua_State* l, lua_Debug*)
+		{
+			lua_pushlightuserdata(l, key());
+			lua_rawget(l, LUA_REGISTRYINDEX);
+			Profiler* self = static_cast<Profiler*>(lua_touserdata(l, -1));
+			lua_pop(l, 1);
+			if (!self)
+			{
+				return;
+			}
+			if (self->timer_mode_)
+			{
+				if (!self->sample_requested_)
+				{
+					return;
+				}
+				self->sample_requested_ = false;
+			}
+			try
+			{
+				self->sample(l);
+			}
+			catch (...)
+			{//out of memory. drop sample
+			}
+		}
+
+		lua_State* state_;
+		int interval_;
+		int max_depth_;
+		bool running_;
+		bool timer_mode_;
+#if KAGUYA_USE_CPP11
+		std::atomic<bool> sample_requested_;
+#else
+		volatile bool sample_requested_;
+#endif
+		size_t sample_count_;
+		std::map<std::string, size_t> samples_;
+		std::string stack_;
+		lua_Hook prev_hook_;
+		int prev_mask_;
+		int prev_count_;
+	};
+}
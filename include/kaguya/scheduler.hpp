@@ -0,0 +1,546 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "kaguya/config.hpp"
+#include "kaguya/utility.hpp"
+#include "kaguya/error_handler.hpp"
+#include "kaguya/state.hpp"
+#include "kaguya/lua_ref_function.hpp"
+
+namespace kaguya
+{
+	/**
+	* Result of asynchronous operation awaited by scheduled coroutine.
+	* ready() is polled by CoroutineScheduler::update and pushResult is called on the scheduler thread.
+	*/
+	struct AsyncOperation
+	{
+		//! return true if result is available.
+		virtual bool ready() = 0;
+		//! push results to coroutine stack and return number of pushed values.
+		virtual int pushResult(lua_State* thread) = 0;
+		virtual ~AsyncOperation() {}
+	};
+
+	/**
+	* Cooperative scheduler for many coroutines running on one Lua state.
+	*
+	* Tasks are resumed directly with lua_resume in priority order (higher first),
+	* round-robin among tasks of the same priority. Time is supplied by the caller
+	* through update(), so the scheduler can be driven by any event loop.
+	* Task slots, queues and per event waiter lists are recycled, so steady-state resumes do not allocate.
+	* (waiter list is kept for each event id once waited)
+	* Scheduler must be destroyed before its lua_State is closed, because destructor releases task references.
+	*
+	* Lua side interface is returned by library():
+	* @code
+	* sched.sleep(seconds)          -- suspend task for seconds
+	* sched.wait(event [,timeout])  -- suspend until notify(event), returns false on timeout
+	* sched.yield()                 -- give other tasks a chance (same as coroutine.yield)
+	* @endcode
+	*/
+	class CoroutineScheduler
+	{
+	public:
+		typedef int TaskId;
+		typedef int EventId;
+
+		//! task status
+		enum task_status
+		{
+			TASK_DEAD,//!< finished, killed or unused slot
+			TASK_READY,//!< queued for resume
+			TASK_SLEEPING,//!< waiting for wake up time
+			TASK_WAITING,//!< waiting for event
+			TASK_PENDING,//!< waiting for async operation
+		};
+
+		explicit CoroutineScheduler(lua_State* state) :state_(state), now_(0), seq_(0), current_(-1), active_count_(0)
+		{
+		}
+		~CoroutineScheduler()
+		{
+			for (size_t i = 0; i < tasks_.size(); ++i)
+			{
+				if (tasks_[i].status != TASK_DEAD)
+				{
+					release(int(i));
+				}
+			}
+		}
+
+		/**
+		* @brief create new coroutine from function and queue it.
+		* @param fun function executed in coroutine
+		* @param priority task with higher priority is resumed first
+		* @return task id. id is reused after task is finished.
+		*/
+		TaskId spawn(const LuaFunction& fun, int priority = 0)
+		{
+			if (fun.isNilref())
+			{
+				except::typeMismatchError(state_, "is nil");
+				return -1;
+			}
+			int index = allocateTask();
+			Task& task = tasks_[index];
+			task.thread = lua_newthread(state_);
+			task.ref = luaL_ref(state_, LUA_REGISTRYINDEX);
+			task.priority = priority;
+			fun.push(state_);
+			lua_xmove(state_, task.thread, 1);
+			++active_count_;
+			makeReady(index);
+			return index;
+		}
+
+		//! kill task. running task can not kill
+		bool kill(TaskId id)
+		{
+			if (!isValidTask(id) || id == current_)
+			{
+				return false;
+			}
+			release(id);
+			return true;
+		}
+
+		//! resume waiting or sleeping task at next update
+		bool wake(TaskId id)
+		{
+			if (!isValidTask(id) || tasks_[id].status == TASK_READY || tasks_[id].status == TASK_PENDING)
+			{
+				return false;
+			}
+			if (tasks_[id].status == TASK_WAITING)
+			{
+				removeWaiter(id);
+			}
+			tasks_[id].resume_flag = 1;
+			makeReady(id);
+			return true;
+		}
+
+		//! wake all tasks waiting for event
+		size_t notify(EventId event)
+		{
+			WaiterMap::iterator it = waiters_.find(event);
+			if (it == waiters_.end())
+			{
+				return 0;
+			}
+			size_t count = 0;
+			std::vector<int>& waiters = it->second;
+			for (size_t i = 0; i < waiters.size(); ++i)
+			{
+				Task& task = tasks_[waiters[i]];
+				if (task.status == TASK_WAITING && task.event == event)
+				{
+					task.resume_flag = 1;
+					makeReady(waiters[i]);
+					++count;
+				}
+			}
+			waiters.clear();//keep capacity for next wait
+			return count;
+		}
+
+		//! number of tasks waiting for event
+		size_t waitingCount(EventId event)const
+		{
+			WaiterMap::const_iterator it = waiters_.find(event);
+			return it == waiters_.end() ? 0 : it->second.size();
+		}
+
+		/**
+		* @brief wake sleeping tasks and resume ready tasks.
+		* Tasks that become ready during this call are resumed at next update.
+		* @param now current time in seconds. must be monotonic.
+		* @return number of resumed tasks
+		*/
+		size_t update(double now)
+		{
+			now_ = now;
+			while (!sleeping_.empty() && sleeping_.front().time <= now_)
+			{
+				TimerEntry entry = sleeping_.front();
+				std::pop_heap(sleeping_.begin(), sleeping_.end());
+				sleeping_.pop_back();
+				Task& task = tasks_[entry.index];
+				if (task.token == entry.token
+					&& (task.status == TASK_SLEEPING || task.status == TASK_WAITING))
+				{
+					if (task.status == TASK_WAITING)
+					{//timed out
+						removeWaiter(entry.index);
+						task.resume_flag = 0;
+					}
+					else
+					{
+						task.resume_flag = -1;
+					}
+					makeReady(entry.index);
+				}
+			}
+
+			for (size_t i = 0; i < pending_.size();)
+			{
+				Task& task = tasks_[pending_[i]];
+				if (task.status == TASK_PENDING && task.operation && !task.operation->ready())
+				{
+					++i;
+					continue;
+				}
+				if (task.status == TASK_PENDING)
+				{
+					makeReady(pending_[i]);
+				}
+				pending_[i] = pending_.back();
+				pending_.pop_back();
+			}
+
+			size_t resumed = 0;
+			unsigned long seq_limit = seq_;
+			while (!ready_.empty())
+			{
+				ReadyEntry entry = ready_.front();
+				std::pop_heap(ready_.begin(), ready_.end());
+				ready_.pop_back();
+				if (tasks_[entry.index].token != entry.token || tasks_[entry.index].status != TASK_READY)
+				{
+					continue;//stale entry
+				}
+				if (entry.seq >= seq_limit)
+				{//queued in this update
+					deferred_.push_back(entry);
+					continue;
+				}
+				resume(entry.index);
+				++resumed;
+			}
+			for (size_t i = 0; i < deferred_.size(); ++i)
+			{
+				ready_.push_back(deferred_[i]);
+				std::push_heap(ready_.begin(), ready_.end());
+			}
+			deferred_.clear();
+			return resumed;
+		}
+
+		//! return task status
+		task_status status(TaskId id)const
+		{
+			if (id < 0 || size_t(id) >= tasks_.size())
+			{
+				return TASK_DEAD;
+			}
+			return tasks_[id].status;
+		}
+
+		//! return time passed to last update
+		double now()const { return now_; }
+
+		//! number of alive tasks
+		size_t size()const { return active_count_; }
+
+		//! if there are no alive tasks,return true
+		bool empty()const { return active_count_ == 0; }
+
+		//! return true if tasks are queued for resume
+		bool hasReadyTask()const { return !ready_.empty(); }
+
+		//! return true if tasks are waiting for async operation
+		bool hasPendingOperation()const { return !pending_.empty(); }
+
+		//! return earliest wake up time of sleeping tasks. if nothing,return negative value
+		double nextWakeTime()const
+		{
+			return sleeping_.empty() ? -1 : sleeping_.front().time;
+		}
+
+		//! running task id. if not in task return -1
+		TaskId currentTask()const { return current_; }
+
+		//! return true if l is coroutine of running task
+		bool isRunningTask(lua_State* l)const
+		{
+			return current_ >= 0 && tasks_[current_].thread == l;
+		}
+
+		/**
+		* @brief suspend running task until operation is ready.
+		* must be followed by lua_yield in lua_CFunction called by task l.
+		* @return if l is not running task return false.
+		*/
+		bool suspend(lua_State* l, const standard::shared_ptr<AsyncOperation>& operation)
+		{
+			if (!isRunningTask(l) || !operation)
+			{
+				return false;
+			}
+			Task& task = tasks_[current_];
+			task.status = TASK_PENDING;
+			task.operation = operation;
+			pending_.push_back(current_);
+			return true;
+		}
+
+		//! return lua_State of scheduler
+		lua_State* state()const { return state_; }
+
+		//! reserve capacity for task count
+		void reserve(size_t count)
+		{
+			tasks_.reserve(count);
+			free_.reserve(count);
+			pending_.reserve(count);
+			ready_.reserve(count);
+			deferred_.reserve(count);
+			sleeping_.reserve(count);
+		}
+
+		/**
+		* @brief return table of Lua interface functions(sleep,wait,yield).
+		* scheduler must be alive while functions are used.
+		*/
+		LuaTable library()
+		{
+			util::ScopedSavedStack save(state_);
+			LuaTable lib(state_);
+			lib.push(state_);
+			lua_pushlightuserdata(state_, this);
+			lua_pushcclosure(state_, &lua_sleep, 1);
+			lua_setfield(state_, -2, "sleep");
+			lua_pushlightuserdata(state_, this);
+			lua_pushcclosure(state_, &lua_wait, 1);
+			lua_setfield(state_, -2, "wait");
+			lua_pushlightuserdata(state_, this);
+			lua_pushcclosure(state_, &lua_yield_task, 1);
+			lua_setfield(state_, -2, "yield");
+			return lib;
+		}
+
+	private:
+		//non copyable
+		CoroutineScheduler(const CoroutineScheduler&);
+		CoroutineScheduler& operator =(const CoroutineScheduler&);
+
+		struct Task
+		{
+			Task() :thread(0), ref(LUA_REFNIL), priority(0), status(TASK_DEAD), event(0), token(0), resume_flag(-1) {}
+			lua_State* thread;
+			int ref;
+			int priority;
+			task_status status;
+			EventId event;
+			unsigned int token;//increment when status changed.for invalidate queue entry
+			int resume_flag;//-1:no resume value, 0:push false, 1:push true
+			standard::shared_ptr<AsyncOperation> operation;
+		};
+		struct ReadyEntry
+		{
+			int priority;
+			unsigned long seq;
+			int index;
+			unsigned int token;
+			bool operator<(const ReadyEntry& other)const
+			{//max heap:higher priority,older sequence first
+				if (priority != other.priority) { return priority < other.priority; }
+				return seq > other.seq;
+			}
+		};
+		struct TimerEntry
+		{
+			double time;
+			int index;
+			unsigned int token;
+			bool operator<(const TimerEntry& other)const
+			{//max heap:earliest time first
+				return time > other.time;
+			}
+		};
+		typedef std::map<EventId, std::vector<int> > WaiterMap;
+
+		bool isValidTask(TaskId id)const
+		{
+			return id >= 0 && size_t(id) < tasks_.size() && tasks_[id].status != TASK_DEAD;
+		}
+
+		int allocateTask()
+		{
+			if (!free_.empty())
+			{
+				int index = free_.back();
+				free_.pop_back();
+				return index;
+			}
+			tasks_.push_back(Task());
+			return int(tasks_.size() - 1);
+		}
+		void release(int index)
+		{
+			Task& task = tasks_[index];
+			if (task.status == TASK_WAITING)
+			{
+				removeWaiter(index);
+			}
+			luaL_unref(state_, LUA_REGISTRYINDEX, task.ref);
+			task.thread = 0;
+			task.ref = LUA_REFNIL;
+			task.status = TASK_DEAD;
+			task.resume_flag = -1;
+			task.operation.reset();
+			++task.token;
+			free_.push_back(index);
+			--active_count_;
+		}
+		void makeReady(int index)
+		{
+			Task& task = tasks_[index];
+			task.status = TASK_READY;
+			ReadyEntry entry;
+			entry.priority = task.priority;
+			entry.seq = seq_++;
+			entry.index = index;
+			entry.token = ++task.token;
+			ready_.push_back(entry);
+			std::push_heap(ready_.begin(), ready_.end());
+		}
+		//! remove waiting task from waiter list of its event
+		void removeWaiter(int index)
+		{
+			WaiterMap::iterator it = waiters_.find(tasks_[index].event);
+			if (it == waiters_.end())
+			{
+				return;
+			}
+			std::vector<int>& waiters = it->second;
+			std::vector<int>::iterator found = std::find(waiters.begin(), waiters.end(), index);
+			if (found != waiters.end())
+			{
+				*found = waiters.back();
+				waiters.pop_back();
+			}
+		}
+		void addTimer(int index, double time)
+		{
+			TimerEntry entry;
+			entry.time = time;
+			entry.index = index;
+			entry.token = tasks_[index].token;
+			sleeping_.push_back(entry);
+			std::push_heap(sleeping_.begin(), sleeping_.end());
+		}
+
+		void resume(int index)
+		{
+			lua_State* thread = tasks_[index].thread;
+			int nargs = 0;
+			if (tasks_[index].operation)
+			{
+				nargs = tasks_[index].operation->pushResult(thread);
+				tasks_[index].operation.reset();
+			}
+			else if (tasks_[index].resume_flag >= 0)
+			{
+				lua_pushboolean(thread, tasks_[index].resume_flag);
+				nargs = 1;
+			}
+			tasks_[index].resume_flag = -1;
+
+			current_ = index;
+#if LUA_VERSION_NUM >= 502
+			int result = lua_resume(thread, 0, nargs);
+#else
+			int result = lua_resume(thread, nargs);
+#endif
+			current_ = -1;
+
+			Task& task = tasks_[index];//reference may be invalid after resume
+			if (result == LUA_YIELD)
+			{
+				lua_settop(thread, 0);//discard yielded values
+				if (task.status == TASK_READY)
+				{//plain yield
+					makeReady(index);
+				}
+				else if (task.status == TASK_WAITING)
+				{
+					waiters_[task.event].push_back(index);
+				}
+			}
+			else
+			{
+				util::ScopedSavedStack save(state_);
+				lua_rawgeti(state_, LUA_REGISTRYINDEX, task.ref);//keep thread alive while error handling
+				release(index);
+				if (result != 0)
+				{
+					ErrorHandler::instance().handle(result, thread);
+				}
+			}
+		}
+
+		static CoroutineScheduler* self(lua_State* l)
+		{
+			CoroutineScheduler* scheduler = static_cast<CoroutineScheduler*>(lua_touserdata(l, lua_upvalueindex(1)));
+			if (!scheduler->isRunningTask(l))
+			{
+				return 0;
+			}
+			return scheduler;
+		}
+		static int lua_sleep(lua_State* l)
+		{
+			CoroutineScheduler* scheduler = self(l);
+			if (!scheduler)
+			{
+				return luaL_error(l, "sleep must be called from scheduled task");
+			}
+			double seconds = lua_tonumber(l, 1);
+			scheduler->tasks_[scheduler->current_].status = TASK_SLEEPING;
+			scheduler->addTimer(scheduler->current_, scheduler->now_ + seconds);
+			return lua_yield(l, 0);
+		}
+		static int lua_wait(lua_State* l)
+		{
+			CoroutineScheduler* scheduler = self(l);
+			if (!scheduler)
+			{
+				return luaL_error(l, "wait must be called from scheduled task");
+			}
+			Task& task = scheduler->tasks_[scheduler->current_];
+			task.status = TASK_WAITING;
+			task.event = EventId(lua_tointeger(l, 1));
+			if (lua_type(l, 2) == LUA_TNUMBER)
+			{
+				scheduler->addTimer(scheduler->current_, scheduler->now_ + lua_tonumber(l, 2));
+			}
+			return lua_yield(l, 0);
+		}
+		static int lua_yield_task(lua_State* l)
+		{
+			if (!self(l))
+			{
+				return luaL_error(l, "yield must be called from scheduled task");
+			}
+			return lua_yield(l, 0);
+		}
+
+		lua_State* state_;
+		double now_;
+		unsigned long seq_;
+		int current_;
+		size_t active_count_;
+		std::vector<Task> tasks_;
+		std::vector<int> free_;
+		std::vector<int> pending_;
+		std::vector<ReadyEntry> ready_;
+		std::vector<ReadyEntry> deferred_;
+		std::vector<TimerEntry> sleeping_;
+		WaiterMap waiters_;
+	};
+}
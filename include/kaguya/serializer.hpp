@@ -0,0 +1,544 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <cstring>
+
+#include "kaguya/config.hpp"
+#include "kaguya/utility.hpp"
+#include "kaguya/error_handler.hpp"
+#include "kaguya/lua_ref.hpp"
+#include "kaguya/object.hpp"
+
+namespace kaguya
+{
+	/**
+	* Output of Serializer.
+	*/
+	struct SerializeSink
+	{
+		virtual void write(const char* data, size_t size) = 0;
+		virtual ~SerializeSink() {}
+	};
+
+	//! SerializeSink appending to std::string
+	struct StringSink :SerializeSink
+	{
+		explicit StringSink(std::string& out) :out_(out) {}
+		virtual void write(const char* data, size_t size)
+		{
+			out_.append(data, size);
+		}
+	private:
+		std::string& out_;
+	};
+
+	namespace serializer_detail
+	{
+		enum tag_type
+		{
+			TAG_NIL = 0,
+			TAG_FALSE,
+			TAG_TRUE,
+			TAG_INTEGER,//zigzag varint
+			TAG_NUMBER,//IEEE754 double little endian
+			TAG_STRING,//varint length + bytes
+			TAG_TABLE,//key value pairs + TAG_END
+			TAG_END,
+			TAG_REF,//varint index of table already appeared
+			TAG_USERDATA//metatable name + hook encoded value
+		};
+		static const unsigned char FORMAT_VERSION = 1;
+		static const int MAX_DEPTH = 200;
+
+		//buffered writer. flush to sink per block
+		class Writer
+		{
+		public:
+			explicit Writer(SerializeSink& sink) :sink_(sink), size_(0) {}
+			~Writer() { flush(); }
+			void byte(unsigned char v)
+			{
+				if (size_ == BUFFER_SIZE) { flush(); }
+				buffer_[size_++] = static_cast<char>(v);
+			}
+			void varint(unsigned long long v)
+			{
+				while (v >= 0x80)
+				{
+					byte(static_cast<unsigned char>(v | 0x80));
+					v >>= 7;
+				}
+				byte(static_cast<unsigned char>(v));
+			}
+			void integer(long long v)
+			{
+				varint((static_cast<unsigned long long>(v) << 1) ^ static_cast<unsigned long long>(v >> 63));
+			}
+			void number(double v)
+			{
+				unsigned long long bits;
+				std::memcpy(&bits, &v, sizeof(bits));
+				for (int i = 0; i < 8; ++i)
+				{
+					byte(static_cast<unsigned char>(bits >> (i * 8)));
+				}
+			}
+			void bytes(const char* data, size_t size)
+			{
+				varint(size);
+				if (size > BUFFER_SIZE - size_)
+				{
+					flush();
+					if (size > BUFFER_SIZE)
+					{//large string is written directly
+						sink_.write(data, size);
+						return;
+					}
+				}
+				std::memcpy(buffer_ + size_, data, size);
+				size_ += size;
+			}
+			void flush()
+			{
+				if (size_)
+				{
+					sink_.write(buffer_, size_);
+					size_ = 0;
+				}
+			}
+		private:
+			static const size_t BUFFER_SIZE = 4096;
+			SerializeSink& sink_;
+			char buffer_[BUFFER_SIZE];
+			size_t size_;
+		};
+
+		class Reader
+		{
+		public:
+			Reader(const char* data, size_t size) :p_(data), end_(data + size) {}
+			bool byte(unsigned char& v)
+			{
+				if (p_ == end_) { return false; }
+				v = static_cast<unsigned char>(*p_++);
+				return true;
+			}
+			bool peek(unsigned char& v)const
+			{
+				if (p_ == end_) { return false; }
+				v = static_cast<unsigned char>(*p_);
+				return true;
+			}
+			bool varint(unsigned long long& v)
+			{
+				v = 0;
+				for (int shift = 0; shift < 64; shift += 7)
+				{
+					unsigned char b;
+					if (!byte(b)) { return false; }
+					v |= static_cast<unsigned long long>(b & 0x7F) << shift;
+					if (!(b & 0x80)) { return true; }
+				}
+				return false;
+			}
+			bool integer(long long& v)
+			{
+				unsigned long long u;
+				if (!varint(u)) { return false; }
+				v = static_cast<long long>(u >> 1) ^ -static_cast<long long>(u & 1);
+				return true;
+			}
+			bool number(double& v)
+			{
+				if (end_ - p_ < 8) { return false; }
+				unsigned long long bits = 0;
+				for (int i = 0; i < 8; ++i)
+				{
+					bits |= static_cast<unsigned long long>(static_cast<unsigned char>(p_[i])) << (i * 8);
+				}
+				p_ += 8;
+				std::memcpy(&v, &bits, sizeof(v));
+				return true;
+			}
+			bool bytes(const char*& data, size_t& size)
+			{
+				unsigned long long length;
+				if (!varint(length) || length > static_cast<unsigned long long>(end_ - p_)) { return false; }
+				data = p_;
+				size = static_cast<size_t>(length);
+				p_ += size;
+				return true;
+			}
+			bool atEnd()const { return p_ == end_; }
+		private:
+			const char* p_;
+			const char* end_;
+		};
+	}
+
+	/**
+	* Binary serializer of Lua values for transfer between States or persistence.
+	* Supports nil, boolean, number(integer and float are distinguished on Lua5.3), string,
+	* table(shared and cyclic references are kept) and userdata that has registered hook.
+	* Metatables of tables, functions and threads are not supported.
+	* @code
+	* kaguya::Serializer serializer;
+	* std::string data;
+	* serializer.serialize(source["config"], data);
+	* target["config"] = serializer.deserialize(target.state(), data);
+	* @endcode
+	*/
+	class Serializer
+	{
+	public:
+		//! convert userdata to serializable Lua value
+		typedef standard::function<LuaRef(const LuaRef&)> encode_hook_type;
+		//! convert decoded Lua value to userdata. argument belongs to destination state
+		typedef standard::function<LuaRef(const LuaRef&)> decode_hook_type;
+
+		/**
+		* @brief register userdata conversion for metatable name.
+		*/
+		void addUserdataHook(const std::string& metatable_name, encode_hook_type encode, decode_hook_type decode)
+		{
+			UserdataHook hook = { metatable_name, encode, decode };
+			hooks_.push_back(hook);
+		}
+		//! register userdata conversion for class registered by ClassMetatable<T>
+		template<typename T>
+		void addUserdataHook(encode_hook_type encode, decode_hook_type decode)
+		{
+			addUserdataHook(metatableName<T>(), encode, decode);
+		}
+
+		/**
+		* @brief serialize value to sink.
+		* If unsupported value is found, send error message to error handler and return false.
+		* (partial output is already written to sink)
+		*/
+		bool serialize(const LuaRef& value, SerializeSink& sink)const
+		{
+			lua_State* state = value.state();
+			if (!state)
+			{
+				serializer_detail::Writer writer(sink);
+				writer.byte(serializer_detail::FORMAT_VERSION);
+				writer.byte(serializer_detail::TAG_NIL);
+				return true;
+			}
+			util::ScopedSavedStack save(state);
+			value.push(state);
+			return serialize(state, -1, sink);
+		}
+		//! serialize value at stack index to sink
+		bool serialize(lua_State* state, int index, SerializeSink& sink)const
+		{
+			index = lua_absindex(state, index);
+			std::map<const void*, size_t> tables;
+			std::vector<LuaRef> converted_values;//keep alive. addresses in tables must not be reused
+			std::string error;
+			{
+				serializer_detail::Writer writer(sink);
+				writer.byte(serializer_detail::FORMAT_VERSION);
+				if (encode(state, index, writer, tables, converted_values, 0, error))
+				{
+					return true;
+				}
+			}
+			except::OtherError(state, error);
+			return false;
+		}
+		//! serialize value and append to out
+		bool serialize(const LuaRef& value, std::string& out)const
+		{
+			StringSink sink(out);
+			return serialize(value, sink);
+		}
+
+		/**
+		* @brief decode data and push value to stack.
+		* @return If there are no errors, returns true. Otherwise push nothing and return false
+		*/
+		bool deserializeToStack(lua_State* state, const char* data, size_t size)const
+		{
+			int top = lua_gettop(state);
+			serializer_detail::Reader reader(data, size);
+			unsigned char version = 0;
+			std::string error = "invalid serialized data";
+			if (reader.byte(version) && version == serializer_detail::FORMAT_VERSION)
+			{
+				lua_newtable(state);//decoded tables for reference
+				int refs = lua_gettop(state);
+				int count = 0;
+				if (decode(state, reader, refs, count, 0, error) && reader.atEnd())
+				{
+					lua_remove(state, refs);
+					return true;
+				}
+			}
+			lua_settop(state, top);
+			except::OtherError(state, error);
+			return false;
+		}
+		/**
+		* @brief decode data to value in state.
+		* On error, send error message to error handler and return nil reference
+		*/
+		LuaRef deserialize(lua_State* state, const char* data, size_t size)const
+		{
+			util::ScopedSavedStack save(state);
+			if (!deserializeToStack(state, data, size))
+			{
+				return LuaRef(state);
+			}
+			return LuaRef(state, StackTop());
+		}
+		LuaRef deserialize(lua_State* state, const std::string& data)const
+		{
+			return deserialize(state, data.data(), data.size());
+		}
+	private:
+		struct UserdataHook
+		{
+			std::string name;
+			encode_hook_type encode;
+			decode_hook_type decode;
+		};
+
+		const UserdataHook* findHook(lua_State* state, int index)const
+		{
+			if (!lua_getmetatable(state, index))
+			{
+				return 0;
+			}
+			for (size_t i = 0; i < hooks_.size(); ++i)
+			{
+				luaL_getmetatable(state, hooks_[i].name.c_str());
+				bool match = lua_rawequal(state, -1, -2) != 0;
+				lua_pop(state, 1);
+				if (match)
+				{
+					lua_pop(state, 1);
+					return &hooks_[i];
+				}
+			}
+			lua_pop(state, 1);
+			return 0;
+		}
+		const UserdataHook* findHook(const std::string& name)const
+		{
+			for (size_t i = 0; i < hooks_.size(); ++i)
+			{
+				if (hooks_[i].name == name)
+				{
+					return &hooks_[i];
+				}
+			}
+			return 0;
+		}
+
+		bool encode(lua_State* state, int index, serializer_detail::Writer& writer, std::map<const void*, size_t>& tables, std::vector<LuaRef>& converted_values, int depth, std::string& error)const
+		{
+			using namespace serializer_detail;
+			if (depth > MAX_DEPTH || !lua_checkstack(state, 3))
+			{
+				error = "serialize: nesting too deep";
+				return false;
+			}
+			switch (lua_type(state, index))
+			{
+			case LUA_TNIL:
+				writer.byte(TAG_NIL);
+				return true;
+			case LUA_TBOOLEAN:
+				writer.byte(lua_toboolean(state, index) ? TAG_TRUE : TAG_FALSE);
+				return true;
+			case LUA_TNUMBER:
+			{
+#if LUA_VERSION_NUM >= 503
+				if (lua_isinteger(state, index))
+				{
+					writer.byte(TAG_INTEGER);
+					writer.integer(static_cast<long long>(lua_tointeger(state, index)));
+					return true;
+				}
+				writer.byte(TAG_NUMBER);
+				writer.number(static_cast<double>(lua_tonumber(state, index)));
+#else
+				double v = static_cast<double>(lua_tonumber(state, index));
+				if (v == std::floor(v) && std::fabs(v) < 9007199254740992.0)
+				{
+					writer.byte(TAG_INTEGER);
+					writer.integer(static_cast<long long>(v));
+					return true;
+				}
+				writer.byte(TAG_NUMBER);
+				writer.number(v);
+#endif
+				return true;
+			}
+			case LUA_TSTRING:
+			{
+				size_t size = 0;
+				const char* data = lua_tolstring(state, index, &size);
+				writer.byte(TAG_STRING);
+				writer.bytes(data, size);
+				return true;
+			}
+			case LUA_TTABLE:
+			{
+				const void* address = lua_topointer(state, index);
+				std::map<const void*, size_t>::const_iterator found = tables.find(address);
+				if (found != tables.end())
+				{
+					writer.byte(TAG_REF);
+					writer.varint(found->second);
+					return true;
+				}
+				size_t id = tables.size() + 1;
+				tables[address] = id;
+				writer.byte(TAG_TABLE);
+				lua_pushnil(state);
+				while (lua_next(state, index))
+				{
+					int top = lua_gettop(state);
+					if (!encode(state, top - 1, writer, tables, converted_values, depth + 1, error)
+						|| !encode(state, top, writer, tables, converted_values, depth + 1, error))
+					{
+						lua_pop(state, 2);
+						return false;
+					}
+					lua_pop(state, 1);
+				}
+				writer.byte(TAG_END);
+				return true;
+			}
+			case LUA_TUSERDATA:
+			{
+				const UserdataHook* hook = findHook(state, index);
+				if (!hook)
+				{
+					error = "serialize: userdata without hook";
+					return false;
+				}
+				lua_pushvalue(state, index);
+				converted_values.push_back(hook->encode(LuaRef(state, StackTop())));
+				writer.byte(TAG_USERDATA);
+				writer.bytes(hook->name.data(), hook->name.size());
+				util::ScopedSavedStack save(state);
+				converted_values.back().push(state);
+				return encode(state, lua_gettop(state), writer, tables, converted_values, depth + 1, error);
+			}
+			default:
+				error = std::string("serialize: unsupported type ") + lua_typename(state, lua_type(state, index));
+				return false;
+			}
+		}
+
+		bool decode(lua_State* state, serializer_detail::Reader& reader, int refs, int& count, int depth, std::string& error)const
+		{
+			using namespace serializer_detail;
+			if (depth > MAX_DEPTH || !lua_checkstack(state, 3))
+			{
+				error = "deserialize: nesting too deep";
+				return false;
+			}
+			unsigned char tag;
+			if (!reader.byte(tag))
+			{
+				return false;
+			}
+			switch (tag)
+			{
+			case TAG_NIL:
+				lua_pushnil(state);
+				return true;
+			case TAG_FALSE:
+			case TAG_TRUE:
+				lua_pushboolean(state, tag == TAG_TRUE);
+				return true;
+			case TAG_INTEGER:
+			{
+				long long v;
+				if (!reader.integer(v)) { return false; }
+#if LUA_VERSION_NUM >= 503
+				lua_pushinteger(state, static_cast<lua_Integer>(v));
+#else
+				lua_pushnumber(state, static_cast<lua_Number>(v));
+#endif
+				return true;
+			}
+			case TAG_NUMBER:
+			{
+				double v;
+				if (!reader.number(v)) { return false; }
+				lua_pushnumber(state, static_cast<lua_Number>(v));
+				return true;
+			}
+			case TAG_STRING:
+			{
+				const char* data;
+				size_t size;
+				if (!reader.bytes(data, size)) { return false; }
+				lua_pushlstring(state, data, size);
+				return true;
+			}
+			case TAG_TABLE:
+			{
+				lua_newtable(state);
+				lua_pushvalue(state, -1);
+				lua_rawseti(state, refs, ++count);
+				for (;;)
+				{
+					unsigned char next;
+					if (!reader.peek(next)) { return false; }
+					if (next == TAG_END)
+					{
+						reader.byte(next);
+						return true;
+					}
+					if (!decode(state, reader, refs, count, depth + 1, error)) { return false; }
+					if (lua_isnil(state, -1)) { return false; }
+					if (lua_type(state, -1) == LUA_TNUMBER)
+					{
+						lua_Number key = lua_tonumber(state, -1);
+						if (key != key) { return false; }//NaN is not valid key
+					}
+					if (!decode(state, reader, refs, count, depth + 1, error)) { return false; }
+					lua_rawset(state, -3);
+				}
+			}
+			case TAG_REF:
+			{
+				unsigned long long id;
+				if (!reader.varint(id) || id == 0 || id > static_cast<unsigned long long>(count)) { return false; }
+				lua_rawgeti(state, refs, static_cast<int>(id));
+				return true;
+			}
+			case TAG_USERDATA:
+			{
+				const char* data;
+				size_t size;
+				if (!reader.bytes(data, size)) { return false; }
+				const UserdataHook* hook = findHook(std::string(data, size));
+				if (!hook)
+				{
+					error = "deserialize: userdata without hook " + std::string(data, size);
+					return false;
+				}
+				if (!decode(state, reader, refs, count, depth + 1, error)) { return false; }
+				LuaRef value(state, StackTop());
+				hook->decode(value).push(state);
+				return true;
+			}
+			default:
+				return false;
+			}
+		}
+
+		std::vector<UserdataHook> hooks_;
+	};
+}
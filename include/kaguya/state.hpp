@@ -5,6 +5,8 @@
 #include "kaguya/config.hpp"
 
 #include "kaguya/utility.hpp"
+#include "kaguya/exception.hpp"
+#include "kaguya/allocator.hpp"
 #include "kaguya/metatable.hpp"
 #include "kaguya/error_handler.hpp"
 
@@ -16,84 +18,112 @@ namespace kaguya
 	typedef std::pair<std::string, lua_CFunction> LoadLib;
 	typedef std::vector<LoadLib> LoadLibs;
 	inline LoadLibs NoLoadLib() { return LoadLibs(); };
+
+
+	/**
+	* @brief loader of script files used by State::loadfile and State::dofile.
+	* see kaguya/bytecode_cache.hpp
+	*/
+	class FileLoader
+	{
+	public:
+		virtual ~FileLoader() {}
+		/**
+		* @brief load file as Lua function and push to stack.
+		* @return status code of lua_load. On error, error message is pushed instead of function.
+		*/
+		virtual int load(lua_State* state, const char* path) = 0;
+	};
+
 	class State
 	{
+		standard::shared_ptr<void> allocator_holder_;
 		lua_State *state_;
 		bool created_;
+		standard::shared_ptr<FileLoader> file_loader_;
 
 		//non copyable
 		State(const State&);
 		State& operator =(const State&);
 
-		static void stderror_out(int status, const char* message)
-		{
-			std::cerr << message << std::endl;
-		}
-		void init()
-		{
-			if (!ErrorHandler::instance().getHandler(state_))
-			{
-				setErrorHandler(&stderror_out);
-			}
-			nativefunction::reg_functor_destructor(state_);
-		}
+		static void stderror_out(int status, const char* message);
+		static int default_panic(lua_State* state);
+		void init();
+		int loadfileToStack(const char* file);
 
 	public:
 
 		//! create Lua state with lua standard library
-		State() :state_(luaL_newstate()), created_(true)
-		{
-			init();
-			openlibs();
-		}
+		State();
 
 		//! create Lua state with(or without) library
-		State(const LoadLibs& libs) :state_(luaL_newstate()), created_(true)
-		{
-			init();
-			openlibs(libs);
-		}
-		State(lua_State* lua) :state_(lua), created_(false)
+		State(const LoadLibs& libs);
+		State(lua_State* lua);
+
+		/**
+		* @brief create Lua state with lua standard library and allocator
+		* @param allocator allocator object. see kaguya/allocator.hpp.It is released after lua_close.
+		* @throw LuaMemoryError if allocator failed to create Lua state
+		*/
+		template<typename Allocator>
+		explicit State(standard::shared_ptr<Allocator> allocator) :allocator_holder_(allocator), state_(lua_newstate(&AllocatorFunction<Allocator>::call, allocator.get())), created_(true)
 		{
-			init();
+			if (!state_) { throw LuaMemoryError(LUA_ERRMEM, "failed to create lua state by allocator"); }
+			lua_atpanic(state_, &default_panic);
+			try
+			{
+				init();
+				openlibs();
+			}
+			catch (...)
+			{//destructor is not called
+				lua_close(state_);
+				throw;
+			}
 		}
-		~State()
+
+		//! create Lua state with(or without) library and allocator
+		template<typename Allocator>
+		State(const LoadLibs& libs, standard::shared_ptr<Allocator> allocator) :allocator_holder_(allocator), state_(lua_newstate(&AllocatorFunction<Allocator>::call, allocator.get())), created_(true)
 		{
-			if (created_)
+			if (!state_) { throw LuaMemoryError(LUA_ERRMEM, "failed to create lua state by allocator"); }
+			lua_atpanic(state_, &default_panic);
+			try
 			{
+				init();
+				openlibs(libs);
+			}
+			catch (...)
+			{//destructor is not called
 				lua_close(state_);
+				throw;
 			}
 		}
+		~State();
 
-		void setErrorHandler(standard::function<void(int statuscode, const char*message)> errorfunction)
+		/**
+		* @brief set file loader used by loadfile and dofile. e.g. kaguya::BytecodeCache
+		* @param loader file loader. null is load file directly.
+		*/
+		void setFileLoader(standard::shared_ptr<FileLoader> loader)
 		{
-			util::ScopedSavedStack save(state_);
-			ErrorHandler::instance().registerHandler(state_, errorfunction);
+			file_loader_ = loader;
 		}
-
-		//! load all lua standard library
-		void openlibs()
+		standard::shared_ptr<FileLoader> fileLoader()const
 		{
-			util::ScopedSavedStack save(state_);
-			luaL_openlibs(state_);
+			return file_loader_;
 		}
 
-		//! load lua library
-		void openlib(const LoadLib& lib)
-		{
-			util::ScopedSavedStack save(state_);
+		void setErrorHandler(standard::function<void(int statuscode, const char*message)> errorfunction);
 
-			luaL_requiref(state_, lib.first.c_str(), lib.second, 1);
-		}
+		//! load all lua standard library
+		void openlibs();
+
+		//! load lua library
+		void openlib(const LoadLib& lib);
 
 		//! load lua libraries
-		void openlibs(const LoadLibs& libs)
-		{
-			for (LoadLibs::const_iterator it = libs.begin(); it != libs.end(); ++it)
-			{
-				openlib(*it);
-			}
-		}
+		void openlibs(const LoadLibs& libs);
 
 		/**
 		* @name loadfile
@@ -103,14 +133,8 @@ namespace kaguya
 		* @return reference of lua function 
 		*/
 		//@{
-		LuaFunction loadfile(const std::string& file)
-		{
-			return LuaFunction::loadfile(state_,file);
-		}
-		LuaFunction loadfile(const char* file)
-		{
-			return LuaFunction::loadfile(state_, file);
-		}
+		LuaFunction loadfile(const std::string& file);
+		LuaFunction loadfile(const char* file);
 		//@}
 
 
@@ -122,14 +146,8 @@ namespace kaguya
 		* @return reference of lua function 
 		*/
 		//@{
-		LuaFunction loadstring(const std::string& str)
-		{
-			return LuaFunction::loadstring(state_, str);
-		}
-		LuaFunction loadstring(const char* str)
-		{
-			return LuaFunction::loadstring(state_,str);
-		}
+		LuaFunction loadstring(const std::string& str);
+		LuaFunction loadstring(const char* str);
 		//@}
 
 		/**
@@ -140,40 +158,8 @@ namespace kaguya
 		* @return If there are no errors, returns true.Otherwise return false
 		*/
 		//@{
-		bool dofile(const std::string& file, const LuaTable& env = LuaTable())
-		{
-			return dofile(file.c_str(), env);
-		}
-		bool dofile(const char* file, const LuaTable& env = LuaTable())
-		{
-			util::ScopedSavedStack save(state_);
-
-			int status = luaL_loadfile(state_, file);
-
-			if (status)
-			{
-				ErrorHandler::instance().handle(status, state_);
-				return false;
-			}
-
-			if (!env.isNilref())
-			{//register _ENV
-				env.push();
-#if LUA_VERSION_NUM >= 502
-				lua_setupvalue(state_, -2, 1);
-#else
-				lua_setfenv(state_, -2);
-#endif
-			}
-
-			status = lua_pcall(state_, 0, LUA_MULTRET, 0);
-			if (status)
-			{
-				ErrorHandler::instance().handle(status, state_);
-				return false;
-			}
-			return true;
-		}
+		bool dofile(const std::string& file, const LuaTable& env = LuaTable());
+		bool dofile(const char* file, const LuaTable& env = LuaTable());
 		//@}
 
 		/**
@@ -183,64 +169,20 @@ namespace kaguya
 		* @param env execute env table
 		* @return If there are no errors, returns true.Otherwise return false
 		*/
-		bool dostring(const char* str, const LuaTable& env = LuaTable())
-		{
-			util::ScopedSavedStack save(state_);
-
-			int status = luaL_loadstring(state_, str);
-			if (status)
-			{
-				ErrorHandler::instance().handle(status, state_);
-				return false;
-			}
-			if (!env.isNilref())
-			{//register _ENV
-				env.push();
-#if LUA_VERSION_NUM >= 502
-				lua_setupvalue(state_, -2, 1);
-#else
-				lua_setfenv(state_, -2);
-#endif
-			}
-			status = lua_pcall(state_, 0, LUA_MULTRET, 0);
-			if (status)
-			{
-				ErrorHandler::instance().handle(status, state_);
-				return false;
-			}
-			return true;
-		}
-		bool dostring(const std::string& str, const LuaTable& env = LuaTable())
-		{
-			return dostring(str.c_str(), env);
-		}
-		bool operator()(const std::string& str)
-		{
-			return dostring(str);
-		}
-		bool operator()(const char* str)
-		{
-			return dostring(str);
-		}
+		bool dostring(const char* str, const LuaTable& env = LuaTable());
+		bool dostring(const std::string& str, const LuaTable& env = LuaTable());
+		bool operator()(const std::string& str);
+		bool operator()(const char* str);
 		//@}
 
 		//! return element reference from global table
-		TableKeyReference operator[](const std::string& str)
-		{
-			return TableKeyReference(globalTable(), LuaRef(state_, str));
-		}
+		TableKeyReference operator[](const std::string& str);
 
 		//! return element reference from global table
-		TableKeyReference operator[](const char* str)
-		{
-			return TableKeyReference(globalTable(), LuaRef(state_, str));
-		}
+		TableKeyReference operator[](const char* str);
 
 		//! return global table
-		LuaTable globalTable()
-		{
-			return newRef(GlobalTable());
-		}
+		LuaTable globalTable();
 
 		//! return new Lua reference from argument value
 		template<typename T>
@@ -250,21 +192,12 @@ namespace kaguya
 		}
 
 		//! return new Lua table
-		LuaTable newTable()
-		{
-			return LuaTable(state_);
-		}
+		LuaTable newTable();
 		//! return new Lua table
-		LuaTable newTable(int reserve_array, int reserve_record)
-		{
-			return LuaTable(state_, NewTable(reserve_array, reserve_record));
-		}
+		LuaTable newTable(int reserve_array, int reserve_record);
 
 		//! return new Lua thread
-		LuaThread newThread()
-		{
-			return LuaThread(state_);
-		}
+		LuaThread newThread();
 
 		//push to Lua stack
 		template<typename T>
@@ -272,10 +205,7 @@ namespace kaguya
 		{
 			types::push_dispatch(state_, value);
 		}
-		LuaRef popFromStack()
-		{
-			return LuaRef(state_, StackTop());
-		}
+		LuaRef popFromStack();
 
 		//! Garbage Collection of Lua 
 		struct GCType
@@ -366,16 +296,10 @@ namespace kaguya
 			return GCType(state_);
 		}
 		//! performs a full garbage-collection cycle.
-		void garbageCollect()
-		{
-			gc().collect();
-		}
+		void garbageCollect();
 
 		//! returns the current amount of memory (in Kbytes) in use by Lua.
-		size_t useKBytes()const
-		{
-			return size_t(gc().count());
-		}
+		size_t useKBytes()const;
 
 
 
@@ -384,12 +308,7 @@ namespace kaguya
 		* using for Lua module
 		* @return return Lua Table Reference
 		*/
-		LuaRef newLib()
-		{
-			LuaTable newtable = newTable();
-			newtable.push(state_);
-			return newtable;
-		}
+		LuaRef newLib();
 
 		/**
 		* @brief return lua_State*.
@@ -398,3 +317,7 @@ namespace kaguya
 		lua_State *state() { return state_; };
 	};
 };
+
+#if KAGUYA_COMPILE_IMPL
+#include "kaguya/impl/state.inl"
+#endif
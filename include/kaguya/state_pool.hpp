@@ -0,0 +1,469 @@
+#pragma once
+
+#include <vector>
+
+#include "kaguya/config.hpp"
+#include "kaguya/utility.hpp"
+#include "kaguya/state.hpp"
+
+#if KAGUYA_USE_CPP11
+#include <mutex>
+#endif
+
+namespace kaguya
+{
+	namespace pool_detail
+	{
+#if KAGUYA_USE_CPP11
+		typedef std::mutex mutex_type;
+		typedef std::lock_guard<std::mutex> lock_type;
+#else
+		struct mutex_type {};
+		struct lock_type { lock_type(mutex_type&) {} };
+#endif
+
+		//registry key of baseline snapshot
+		inline void* baseline_key()
+		{
+			static char key;
+			return &key;
+		}
+
+		//registry key of PooledState pointer
+		inline void* entry_key()
+		{
+			static char key;
+			return &key;
+		}
+
+		inline void push_loaded_table(lua_State* state)
+		{
+			lua_getfield(state, LUA_REGISTRYINDEX, "_LOADED");
+		}
+
+		//push metatable of string type or nil
+		inline void push_string_metatable(lua_State* state)
+		{
+			lua_pushliteral(state, "");
+			if (!lua_getmetatable(state, -1))
+			{
+				lua_pushnil(state);
+			}
+			lua_remove(state, -2);
+		}
+
+		/**
+		* number of registry references made by luaL_ref.
+		* free reference slots hold numbers, so reference to number value is not counted.
+		*/
+		inline size_t registry_reference_count(lua_State* state)
+		{
+#if LUA_VERSION_NUM >= 502
+			size_t size = lua_rawlen(state, LUA_REGISTRYINDEX);
+#else
+			size_t size = lua_objlen(state, LUA_REGISTRYINDEX);
+#endif
+			size_t count = 0;
+			for (size_t i = 1; i <= size; ++i)
+			{
+				lua_rawgeti(state, LUA_REGISTRYINDEX, int(i));
+				if (lua_type(state, -1) != LUA_TNUMBER && lua_type(state, -1) != LUA_TNIL)
+				{
+					count++;
+				}
+				lua_pop(state, 1);
+			}
+			return count;
+		}
+
+		/**
+		* set metatable of value at index to baseline_index value if different.
+		* @return 1 if repaired
+		*/
+		inline size_t restore_metatable(lua_State* state, int index, int baseline_index)
+		{
+			index = lua_absindex(state, index);
+			baseline_index = lua_absindex(state, baseline_index);
+			if (!lua_getmetatable(state, index))
+			{
+				lua_pushnil(state);
+			}
+			bool same = lua_rawequal(state, -1, baseline_index) != 0;
+			lua_pop(state, 1);
+			if (same)
+			{
+				return 0;
+			}
+			lua_pushvalue(state, baseline_index);
+			lua_setmetatable(state, index);
+			return 1;
+		}
+
+		//return shallow copy of table at index
+		inline void push_table_copy(lua_State* state, int index)
+		{
+			index = lua_absindex(state, index);
+			lua_newtable(state);
+			if (lua_type(state, index) != LUA_TTABLE)
+			{
+				return;
+			}
+			lua_pushnil(state);
+			while (lua_next(state, index))
+			{
+				lua_pushvalue(state, -2);
+				lua_insert(state, -2);
+				lua_rawset(state, -4);
+			}
+		}
+
+		/**
+		* make table at target_index same as baseline_index (shallow).
+		* @return number of repaired entries
+		*/
+		inline size_t restore_table(lua_State* state, int target_index, int baseline_index)
+		{
+			target_index = lua_absindex(state, target_index);
+			baseline_index = lua_absindex(state, baseline_index);
+			if (lua_type(state, target_index) != LUA_TTABLE || lua_type(state, baseline_index) != LUA_TTABLE)
+			{
+				return 0;
+			}
+			size_t repaired = 0;
+			//added or overwritten entries. assigning existing field is allowed during traversal
+			lua_pushnil(state);
+			while (lua_next(state, target_index))
+			{
+				lua_pushvalue(state, -2);
+				lua_rawget(state, baseline_index);
+				if (!lua_rawequal(state, -1, -2))
+				{
+					lua_pushvalue(state, -3);
+					lua_insert(state, -2);
+					lua_rawset(state, target_index);
+					repaired++;
+				}
+				else
+				{
+					lua_pop(state, 1);
+				}
+				lua_pop(state, 1);
+			}
+			//removed entries
+			lua_pushnil(state);
+			while (lua_next(state, baseline_index))
+			{
+				lua_pushvalue(state, -2);
+				lua_rawget(state, target_index);
+				bool removed = lua_isnil(state, -1);
+				lua_pop(state, 1);
+				if (removed)
+				{
+					lua_pushvalue(state, -2);
+					lua_insert(state, -2);
+					lua_rawset(state, target_index);
+					repaired++;
+				}
+				else
+				{
+					lua_pop(state, 1);
+				}
+			}
+			return repaired;
+		}
+	}
+
+	/**
+	* Pool of initialized States.
+	* States are created and set up in advance, and returned to pool when checked out pointer is released.
+	* On return, global table and package.loaded are restored to snapshot taken after setup (shallow),
+	* metatables of global table and string are reset, and the State is discarded if it exceeds memory,
+	* use count or taint limit. Registry references (luaL_ref) added since setup can not be released,
+	* so they are counted as repaired entries.
+	* Changes inside of tables (e.g. string.myfunc = ...) are not restored. Mark such State as tainted.
+	* Thread safe if KAGUYA_USE_CPP11. Each checked out State must be used by one thread at a time.
+	* @code
+	* kaguya::StatePool pool(8, [](kaguya::State& state) { bind_classes(state); });
+	* {
+	*   kaguya::StatePool::StatePtr state = pool.acquire();
+	*   (*state)("handle_request()");
+	* }//returned to pool
+	* @endcode
+	*/
+	class StatePool
+	{
+	public:
+		typedef standard::function<void(State&)> setup_function_type;
+		typedef standard::shared_ptr<State> StatePtr;
+
+		/**
+		* @param size number of States created in advance and max number of idle States
+		* @param setup function called once for each new State
+		*/
+		explicit StatePool(size_t size, setup_function_type setup = setup_function_type()) :impl_(new Impl(size, setup))
+		{
+			for (size_t i = 0; i < size; ++i)
+			{
+				impl_->idle.push_back(impl_->create());
+			}
+		}
+
+		/**
+		* @brief check out State. If no idle State, new State is created.
+		* State returns to pool when all copies of returned pointer are released.
+		*/
+		StatePtr acquire()
+		{
+			PooledState* pooled = 0;
+			{
+				pool_detail::lock_type lock(impl_->mutex);
+				if (!impl_->idle.empty())
+				{
+					pooled = impl_->idle.back();
+					impl_->idle.pop_back();
+				}
+			}
+			if (!pooled)
+			{
+				pooled = impl_->create();
+			}
+			pooled->uses++;
+			pooled->tainted = false;
+			return StatePtr(&pooled->state, Returner(impl_, pooled));
+		}
+
+		//! discard State on return instead of reuse. do nothing for State not checked out from StatePool
+		static void markTainted(const StatePtr& state)
+		{
+			if (!state)
+			{
+				return;
+			}
+			PooledState* pooled = Impl::entry(state->state());
+			if (pooled && &pooled->state == state.get())
+			{
+				pooled->tainted = true;
+			}
+		}
+
+		//! discard State if memory use after return exceeds limit. 0 is unlimited
+		void setMaxKBytes(size_t kbytes)
+		{
+			pool_detail::lock_type lock(impl_->mutex);
+			impl_->max_kbytes = kbytes;
+		}
+		//! discard State after checked out count times. 0 is unlimited
+		void setMaxUses(size_t count)
+		{
+			pool_detail::lock_type lock(impl_->mutex);
+			impl_->max_uses = count;
+		}
+		/**
+		* @brief discard State if repaired entry count exceeds limit. 0 is unlimited
+		* restored globals, package.loaded entries and metatables, and leaked registry references are counted.
+		*/
+		void setMaxRepairs(size_t count)
+		{
+			pool_detail::lock_type lock(impl_->mutex);
+			impl_->max_repairs = count;
+		}
+
+		size_t idleCount()const
+		{
+			pool_detail::lock_type lock(impl_->mutex);
+			return impl_->idle.size();
+		}
+		//! number of States created by this pool
+		size_t createdCount()const
+		{
+			pool_detail::lock_type lock(impl_->mutex);
+			return impl_->created_count;
+		}
+		//! number of States discarded by limit
+		size_t discardedCount()const
+		{
+			pool_detail::lock_type lock(impl_->mutex);
+			return impl_->discarded_count;
+		}
+	private:
+		//non copyable
+		StatePool(const StatePool&);
+		StatePool& operator =(const StatePool&);
+
+		struct PooledState
+		{
+			PooledState() :uses(0), tainted(false) {}
+			State state;
+			size_t uses;
+			bool tainted;
+		};
+
+		//shared with checked out States. alive until all States are returned
+		struct Impl
+		{
+			Impl(size_t size, setup_function_type setup_function) :capacity(size), setup(setup_function)
+				, max_kbytes(0), max_uses(0), max_repairs(0), created_count(0), discarded_count(0)
+			{
+			}
+			~Impl()
+			{
+				for (size_t i = 0; i < idle.size(); ++i)
+				{
+					delete idle[i];
+				}
+			}
+			PooledState* create()
+			{
+				PooledState* pooled = new PooledState();
+				if (setup)
+				{
+					try
+					{
+						setup(pooled->state);
+					}
+					catch (...)
+					{
+						delete pooled;
+						throw;
+					}
+				}
+				snapshot(pooled->state.state());
+				registerEntry(pooled);
+				{
+					lock_type lock(mutex);
+					created_count++;
+				}
+				return pooled;
+			}
+			void release(PooledState* pooled)
+			{
+				size_t kbytes_limit, uses_limit, repairs_limit;
+				{
+					lock_type lock(mutex);
+					kbytes_limit = max_kbytes;
+					uses_limit = max_uses;
+					repairs_limit = max_repairs;
+				}
+				lua_State* state = pooled->state.state();
+				lua_settop(state, 0);
+				size_t repaired = restore(state);
+				bool discard = pooled->tainted
+					|| (uses_limit && pooled->uses >= uses_limit)
+					|| (repairs_limit && repaired > repairs_limit);
+				if (!discard && kbytes_limit && pooled->state.useKBytes() > kbytes_limit)
+				{
+					pooled->state.garbageCollect();
+					discard = pooled->state.useKBytes() > kbytes_limit;
+				}
+				{
+					lock_type lock(mutex);
+					if (discard)
+					{
+						discarded_count++;
+					}
+					else if (idle.size() < capacity)
+					{
+						idle.push_back(pooled);
+						return;
+					}
+				}
+				delete pooled;
+			}
+
+			static void snapshot(lua_State* state)
+			{
+				util::ScopedSavedStack save(state);
+				lua_pushlightuserdata(state, pool_detail::baseline_key());
+				lua_createtable(state, 5, 0);
+				types::push(state, GlobalTable());
+				pool_detail::push_table_copy(state, -1);
+				lua_rawseti(state, -3, 1);
+				if (!lua_getmetatable(state, -1))
+				{
+					lua_pushnil(state);
+				}
+				lua_rawseti(state, -3, 3);
+				lua_pop(state, 1);
+				pool_detail::push_loaded_table(state);
+				pool_detail::push_table_copy(state, -1);
+				lua_rawseti(state, -3, 2);
+				lua_pop(state, 1);
+				pool_detail::push_string_metatable(state);
+				lua_rawseti(state, -2, 4);
+				lua_pushnumber(state, lua_Number(pool_detail::registry_reference_count(state)));
+				lua_rawseti(state, -2, 5);
+				lua_rawset(state, LUA_REGISTRYINDEX);
+			}
+			static void registerEntry(PooledState* pooled)
+			{
+				lua_State* state = pooled->state.state();
+				util::ScopedSavedStack save(state);
+				lua_pushlightuserdata(state, pool_detail::entry_key());
+				lua_pushlightuserdata(state, pooled);
+				lua_rawset(state, LUA_REGISTRYINDEX);
+			}
+			static PooledState* entry(lua_State* state)
+			{
+				util::ScopedSavedStack save(state);
+				lua_pushlightuserdata(state, pool_detail::entry_key());
+				lua_rawget(state, LUA_REGISTRYINDEX);
+				return static_cast<PooledState*>(lua_touserdata(state, -1));
+			}
+			static size_t restore(lua_State* state)
+			{
+				util::ScopedSavedStack save(state);
+				lua_pushlightuserdata(state, pool_detail::baseline_key());
+				lua_rawget(state, LUA_REGISTRYINDEX);
+				int baseline = lua_gettop(state);
+				size_t repaired = 0;
+				types::push(state, GlobalTable());
+				lua_rawgeti(state, baseline, 3);
+				repaired += pool_detail::restore_metatable(state, -2, -1);
+				lua_pop(state, 1);
+				lua_rawgeti(state, baseline, 1);
+				repaired += pool_detail::restore_table(state, -2, -1);
+				lua_pop(state, 2);
+				pool_detail::push_loaded_table(state);
+				lua_rawgeti(state, baseline, 2);
+				repaired += pool_detail::restore_table(state, -2, -1);
+				lua_pop(state, 2);
+				lua_pushliteral(state, "");
+				lua_rawgeti(state, baseline, 4);
+				repaired += pool_detail::restore_metatable(state, -2, -1);
+				lua_pop(state, 2);
+				lua_rawgeti(state, baseline, 5);
+				size_t baseline_references = size_t(lua_tonumber(state, -1));
+				size_t references = pool_detail::registry_reference_count(state);
+				if (references > baseline_references)
+				{//leaked references can not be released. count them for taint threshold
+					repaired += references - baseline_references;
+				}
+				return repaired;
+			}
+
+			typedef pool_detail::lock_type lock_type;
+			mutable pool_detail::mutex_type mutex;
+			std::vector<PooledState*> idle;
+			size_t capacity;
+			setup_function_type setup;
+			size_t max_kbytes;
+			size_t max_uses;
+			size_t max_repairs;
+			size_t created_count;
+			size_t discarded_count;
+		};
+
+		struct Returner
+		{
+			Returner(const standard::shared_ptr<Impl>& pool, PooledState* state) :impl(pool), pooled(state) {}
+			void operator()(State*)
+			{
+				impl->release(pooled);
+			}
+			standard::shared_ptr<Impl> impl;
+			PooledState* pooled;
+		};
+
+		standard::shared_ptr<Impl> impl_;
+	};
+}
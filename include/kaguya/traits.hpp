@@ -166,6 +166,19 @@ namespace kaguya
 				, typename arg_get_type<T>::type>::type
 			>::type type;
 		};
+
+#if KAGUYA_USE_VARIADIC_TEMPLATE
+		//! compile time sequence 0..N-1 for unpacking arguments
+		template<std::size_t... Indexes>
+		struct index_tuple {};
+		template<std::size_t N, std::size_t... Indexes>
+		struct make_index_tuple :make_index_tuple<N - 1, N - 1, Indexes...> {};
+		template<std::size_t... Indexes>
+		struct make_index_tuple<0, Indexes...>
+		{
+			typedef index_tuple<Indexes...> type;
+		};
+#endif
 	}
 
 	namespace types
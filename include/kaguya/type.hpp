@@ -39,7 +39,7 @@ namespace kaguya
 			template<typename T>
 			inline bool strictCheckType(lua_State* l, int index, typetag<T> tag)
 			{
-				ObjectWrapperBase* objwrapper = object_wrapper(l, index, metatableName<T>());
+				ObjectWrapperBase* objwrapper = object_wrapper(l, index, metatableType<T>());
 				return objwrapper != 0;
 			}
 
@@ -100,7 +100,7 @@ namespace kaguya
 				{
 					return true;
 				}
-				return object_wrapper(l, index, metatableName<T>()) != 0;
+				return object_wrapper(l, index, metatableType<T>()) != 0;
 			}
 
 			template<>
@@ -0,0 +1,8 @@
+//compiled part of kaguya. build with KAGUYA_SEPARATE_COMPILATION=1 and link to code built with the same definition
+#define KAGUYA_SOURCE
+
+#include "kaguya/kaguya.hpp"
+
+#if !KAGUYA_SEPARATE_COMPILATION
+#error "src/kaguya.cpp requires KAGUYA_SEPARATE_COMPILATION=1"
+#endif
@@ -1,54 +1,487 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <new>
+#include <sstream>
+
 #include "kaguya/kaguya.hpp"
+#include "kaguya/allocator.hpp"
 
 #include "benchmark_function.hpp"
 
+#if KAGUYA_USE_CPP11
+#include <chrono>
+#endif
+
 
+#if KAGUYA_USE_CPP11
+#define BENCHMARK_NEW_THROW
+#define BENCHMARK_DELETE_NOTHROW noexcept
+#else
+#define BENCHMARK_NEW_THROW throw(std::bad_alloc)
+#define BENCHMARK_DELETE_NOTHROW throw()
+#endif
+
+//C++ allocation counters for --allocations mode. counted only while count_cxx_allocations is true
+namespace
+{
+	bool count_cxx_allocations = false;
+	size_t cxx_allocation_count = 0;
+	size_t cxx_allocation_bytes = 0;
+}
+void* operator new(std::size_t size) BENCHMARK_NEW_THROW
+{
+	if (count_cxx_allocations)
+	{
+		cxx_allocation_count++;
+		cxx_allocation_bytes += size;
+	}
+	void* ptr = std::malloc(size ? size : 1);
+	if (!ptr)
+	{
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+void* operator new[](std::size_t size) BENCHMARK_NEW_THROW
+{
+	return operator new(size);
+}
+void operator delete(void* ptr) BENCHMARK_DELETE_NOTHROW
+{
+	std::free(ptr);
+}
+void operator delete[](void* ptr) BENCHMARK_DELETE_NOTHROW
+{
+	std::free(ptr);
+}
 
-typedef void(*benchmark_function_t)(kaguya::State&);
-typedef std::vector<std::pair<std::string, benchmark_function_t> > benchmark_function_map_t;
-void empty(kaguya::State&)
+typedef void(*benchmark_function_t)(kaguya::State&, int times);
+struct BenchmarkEntry
+{
+	BenchmarkEntry(const std::string& name, benchmark_function_t function, const std::string& baseline = "")
+		:name(name), function(function), baseline(baseline), parameter(0) {}
+	std::string name;
+	benchmark_function_t function;
+	//! name of raw Lua C API implementation of same work
+	std::string baseline;
+	//! name of parameterized benchmark. empty if not parameterized
+	std::string family;
+	int parameter;
+};
+//! entry named family/parameter
+BenchmarkEntry parameterized_entry(const std::string& family, benchmark_function_t function, int parameter)
+{
+	std::ostringstream name;
+	name << family << "/" << parameter;
+	BenchmarkEntry entry(name.str(), function);
+	entry.family = family;
+	entry.parameter = parameter;
+	return entry;
+}
+typedef std::vector<BenchmarkEntry> benchmark_function_map_t;
+void empty(kaguya::State&, int)
 {
 
 }
 
-void execute_benchmark(const benchmark_function_map_t& testmap)
+struct BenchmarkOptions
 {
-	for (benchmark_function_map_t::const_iterator it = testmap.begin(); it != testmap.end(); ++it)
-	{
-		const std::string& test_name = it->first;
+	BenchmarkOptions() :samples(10), min_sample_time(0.05), warmup_time(0.1), max_iterations(100000000), format("text"), count_allocations(false), footprint(false) {}
+	//! number of measured samples
+	int samples;
+	//! seconds of a sample. iterations are increased until a run takes this time
+	double min_sample_time;
+	//! seconds spent before measurement
+	double warmup_time;
+	int max_iterations;
+	//! substring of benchmark name to run
+	std::string filter;
+	//! text, json or csv
+	std::string format;
+	//! measure Lua and C++ allocations per operation
+	bool count_allocations;
+	//! print userdata footprint report instead of benchmarks
+	bool footprint;
+};
+
+//! allocations per operation
+struct AllocationResult
+{
+	AllocationResult() :lua_allocations(0), lua_bytes(0), cxx_allocations(0), cxx_bytes(0) {}
+	//! lua_Alloc calls allocating or growing memory
+	double lua_allocations;
+	double lua_bytes;
+	//! operator new calls
+	double cxx_allocations;
+	double cxx_bytes;
+};
+
+struct BenchmarkResult
+{
+	BenchmarkResult() :parameter(0), iterations(0), mean(0), median(0), p90(0), stddev(0), min(0), max(0), baseline_ratio(0), allocations_measured(false) {}
+	std::string name;
+	std::string baseline;
+	std::string family;
+	int parameter;
+	int iterations;
+	//nanoseconds per operation
+	double mean;
+	double median;
+	double p90;
+	double stddev;
+	double min;
+	double max;
+	//! median / median of baseline. 0 if baseline is not measured
+	double baseline_ratio;
+	bool allocations_measured;
+	AllocationResult allocations;
+};
+
+//! monotonic seconds
+double now()
+{
+#if KAGUYA_USE_CPP11
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+	return double(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
 
+//! run function with fresh State and return seconds. State construction is not measured
+double run_once(benchmark_function_t function, int iterations)
+{
+	kaguya::State state;
+	double start = now();
+	function(state, iterations);
+	return now() - start;
+}
 
-		double total_time = 0;
-		static const int N = 4;
-		for (int i = 0; i < N; ++i)
+//! find iterations that takes min_sample_time. Also works as warmup
+int calibrate(benchmark_function_t function, const BenchmarkOptions& options)
+{
+	int iterations = 1;
+	double warmup_start = now();
+	for (;;)
+	{
+		double elapsed = run_once(function, iterations);
+		if (elapsed >= options.min_sample_time || iterations >= options.max_iterations)
 		{
-			kaguya::State state;
-			double start = state["os"]["clock"]();
+			if (now() - warmup_start >= options.warmup_time)
+			{
+				break;
+			}
+			continue;
+		}
+		double scale = elapsed > 0 ? options.min_sample_time / elapsed * 1.2 : 10;
+		scale = std::min(std::max(scale, 2.0), 10.0);
+		iterations = int(std::min(double(options.max_iterations), iterations * scale));
+	}
+	return iterations;
+}
+
+typedef kaguya::AccountingAllocator<> counting_allocator_type;
+
+//! run function with counting allocators and return allocations. State construction is not counted
+AllocationResult count_allocations_once(benchmark_function_t function, int iterations)
+{
+	kaguya::standard::shared_ptr<counting_allocator_type> allocator(new counting_allocator_type());
+	AllocationResult result;
+	{
+		kaguya::State state(allocator);
+		allocator->resetStats();
+		cxx_allocation_count = 0;
+		cxx_allocation_bytes = 0;
+		count_cxx_allocations = true;
+		function(state, iterations);
+		count_cxx_allocations = false;
+	}
+	const kaguya::MemoryStats& stats = allocator->stats();
+	result.lua_allocations = double(stats.allocation_count + stats.reallocation_count);
+	result.lua_bytes = double(stats.total_allocated_bytes);
+	result.cxx_allocations = double(cxx_allocation_count);
+	result.cxx_bytes = double(cxx_allocation_bytes);
+	return result;
+}
+
+//! allocations per operation. difference of iterations and 2*iterations runs cancels setup cost
+AllocationResult measure_allocations(benchmark_function_t function, int iterations)
+{
+	AllocationResult once = count_allocations_once(function, iterations);
+	AllocationResult twice = count_allocations_once(function, iterations * 2);
+	AllocationResult result;
+	result.lua_allocations = std::max(0.0, twice.lua_allocations - once.lua_allocations) / iterations;
+	result.lua_bytes = std::max(0.0, twice.lua_bytes - once.lua_bytes) / iterations;
+	result.cxx_allocations = std::max(0.0, twice.cxx_allocations - once.cxx_allocations) / iterations;
+	result.cxx_bytes = std::max(0.0, twice.cxx_bytes - once.cxx_bytes) / iterations;
+	return result;
+}
+
+double percentile(const std::vector<double>& sorted, double p)
+{
+	if (sorted.empty()) { return 0; }
+	double rank = p * (sorted.size() - 1);
+	size_t lower = size_t(rank);
+	size_t upper = std::min(lower + 1, sorted.size() - 1);
+	double fraction = rank - lower;
+	return sorted[lower] * (1 - fraction) + sorted[upper] * fraction;
+}
+
+BenchmarkResult execute_benchmark(const std::string& name, benchmark_function_t function, const BenchmarkOptions& options)
+{
+	BenchmarkResult result;
+	result.name = name;
+	result.iterations = calibrate(function, options);
+
+	std::vector<double> ns_per_op;
+	for (int i = 0; i < options.samples; ++i)
+	{
+		double elapsed = run_once(function, result.iterations);
+		ns_per_op.push_back(elapsed * 1e9 / result.iterations);
+	}
+	std::sort(ns_per_op.begin(), ns_per_op.end());
 
-			it->second(state);
+	double sum = 0;
+	for (size_t i = 0; i < ns_per_op.size(); ++i) { sum += ns_per_op[i]; }
+	result.mean = sum / ns_per_op.size();
+	double variance = 0;
+	for (size_t i = 0; i < ns_per_op.size(); ++i) { variance += (ns_per_op[i] - result.mean) * (ns_per_op[i] - result.mean); }
+	result.stddev = ns_per_op.size() > 1 ? std::sqrt(variance / (ns_per_op.size() - 1)) : 0;
+	result.median = percentile(ns_per_op, 0.5);
+	result.p90 = percentile(ns_per_op, 0.9);
+	result.min = ns_per_op.front();
+	result.max = ns_per_op.back();
 
-			double end = state["os"]["clock"]();
-			total_time += end - start;
+	if (options.count_allocations)
+	{
+		result.allocations = measure_allocations(function, result.iterations);
+		result.allocations_measured = true;
+	}
+	return result;
+}
+
+std::string json_escape(const std::string& str)
+{
+	std::string result;
+	for (size_t i = 0; i < str.size(); ++i)
+	{
+		if (str[i] == '"' || str[i] == '\\') { result += '\\'; }
+		result += str[i];
+	}
+	return result;
+}
+
+//! print median of parameterized benchmarks by family, relative to smallest parameter
+void print_scaling(const std::vector<BenchmarkResult>& results)
+{
+	std::vector<std::string> families;
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		if (!results[i].family.empty() && std::find(families.begin(), families.end(), results[i].family) == families.end())
+		{
+			families.push_back(results[i].family);
+		}
+	}
+	for (size_t f = 0; f < families.size(); ++f)
+	{
+		std::cout << "scaling " << families[f] << ":" << std::endl;
+		const BenchmarkResult* first = 0;
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const BenchmarkResult& r = results[i];
+			if (r.family != families[f])
+			{
+				continue;
+			}
+			if (!first)
+			{
+				first = &r;
+			}
+			std::cout << "  " << r.parameter << ": " << r.median << " ns/op";
+			if (first->median > 0)
+			{
+				std::cout << " (" << r.median / first->median << "x of " << first->parameter << ")";
+			}
+			std::cout << std::endl;
 		}
+	}
+}
 
-		std::cout << test_name << " avegrage time:" << total_time/N << std::endl;
+void print_results(const std::vector<BenchmarkResult>& results, const BenchmarkOptions& options)
+{
+	if (options.format == "json")
+	{
+		std::cout << "[\n";
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const BenchmarkResult& r = results[i];
+			std::cout << "  {\"name\":\"" << json_escape(r.name) << "\",\"family\":\"" << json_escape(r.family) << "\",\"parameter\":" << r.parameter
+				<< ",\"iterations\":" << r.iterations
+				<< ",\"samples\":" << options.samples
+				<< ",\"mean_ns\":" << r.mean << ",\"median_ns\":" << r.median << ",\"p90_ns\":" << r.p90
+				<< ",\"stddev_ns\":" << r.stddev << ",\"min_ns\":" << r.min << ",\"max_ns\":" << r.max;
+			if (r.baseline_ratio > 0)
+			{
+				std::cout << ",\"baseline\":\"" << json_escape(r.baseline) << "\",\"baseline_ratio\":" << r.baseline_ratio;
+			}
+			if (r.allocations_measured)
+			{
+				std::cout << ",\"lua_allocs_per_op\":" << r.allocations.lua_allocations << ",\"lua_bytes_per_op\":" << r.allocations.lua_bytes
+					<< ",\"cxx_allocs_per_op\":" << r.allocations.cxx_allocations << ",\"cxx_bytes_per_op\":" << r.allocations.cxx_bytes;
+			}
+			std::cout << "}"
+				<< (i + 1 < results.size() ? "," : "") << "\n";
+		}
+		std::cout << "]" << std::endl;
+	}
+	else if (options.format == "csv")
+	{
+		std::cout << "name,family,parameter,iterations,samples,mean_ns,median_ns,p90_ns,stddev_ns,min_ns,max_ns,baseline,baseline_ratio,lua_allocs_per_op,lua_bytes_per_op,cxx_allocs_per_op,cxx_bytes_per_op\n";
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const BenchmarkResult& r = results[i];
+			std::cout << r.name << "," << r.family << "," << r.parameter << "," << r.iterations << "," << options.samples << "," << r.mean << "," << r.median << ","
+				<< r.p90 << "," << r.stddev << "," << r.min << "," << r.max << "," << r.baseline << "," << r.baseline_ratio << ","
+				<< r.allocations.lua_allocations << "," << r.allocations.lua_bytes << "," << r.allocations.cxx_allocations << "," << r.allocations.cxx_bytes << "\n";
+		}
+		std::cout.flush();
 	}
+	else
+	{
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const BenchmarkResult& r = results[i];
+			std::cout << r.name << ": median " << r.median << " ns/op (p90 " << r.p90 << ", stddev " << r.stddev
+				<< ", " << options.samples << " samples x " << r.iterations << " iterations)";
+			if (r.baseline_ratio > 0)
+			{
+				std::cout << " " << r.baseline_ratio << "x " << r.baseline;
+			}
+			std::cout << std::endl;
+			if (r.allocations_measured)
+			{
+				std::cout << "  allocations/op: lua " << r.allocations.lua_allocations << " (" << r.allocations.lua_bytes << " bytes), c++ "
+					<< r.allocations.cxx_allocations << " (" << r.allocations.cxx_bytes << " bytes)" << std::endl;
+			}
+		}
+		print_scaling(results);
+	}
+}
+
+void print_usage()
+{
+	std::cout << "usage: benchmark [--filter=name] [--format=text|json|csv] [--samples=N] [--min-time=seconds] [--warmup=seconds] [--allocations] [--footprint]" << std::endl;
 }
 
+bool parse_options(int argc, char** argv, BenchmarkOptions& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		std::string::size_type eq = arg.find('=');
+		std::string key = arg.substr(0, eq);
+		std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+		if (key == "--filter") { options.filter = value; }
+		else if (key == "--format") { options.format = value; }
+		else if (key == "--samples") { options.samples = std::max(1, std::atoi(value.c_str())); }
+		else if (key == "--min-time") { options.min_sample_time = std::atof(value.c_str()); }
+		else if (key == "--warmup") { options.warmup_time = std::atof(value.c_str()); }
+		else if (key == "--allocations") { options.count_allocations = true; }
+		else if (key == "--footprint") { options.footprint = true; }
+		else
+		{
+			print_usage();
+			return false;
+		}
+	}
+	if (options.format != "text" && options.format != "json" && options.format != "csv")
+	{
+		print_usage();
+		return false;
+	}
+	return true;
+}
 
-int main()
+int main(int argc, char** argv)
 {
+	BenchmarkOptions options;
+	if (!parse_options(argc, argv, options))
+	{
+		return 1;
+	}
+	if (options.footprint)
+	{
+		print_footprint_report();
+		return 0;
+	}
+
 	benchmark_function_map_t functionmap;
-#define ADD_BENCHMARK(function) functionmap.push_back(std::make_pair(#function,&function));
+#define ADD_BENCHMARK(function) functionmap.push_back(BenchmarkEntry(#function,&function));
+	//register function and its raw Lua C API implementation named function_raw
+#define ADD_BENCHMARK_WITH_RAW(function) functionmap.push_back(BenchmarkEntry(#function "_raw",&function##_raw));\
+	functionmap.push_back(BenchmarkEntry(#function,&function,#function "_raw"));
 	ADD_BENCHMARK(empty);
-	ADD_BENCHMARK(simple_get_set);
-	ADD_BENCHMARK(property_access);
-	ADD_BENCHMARK(object_pointer_register_get_set);
-	ADD_BENCHMARK(call_lua_function);
-	ADD_BENCHMARK(lua_table_access);
-	
-	
+	ADD_BENCHMARK_WITH_RAW(simple_get_set);
+	ADD_BENCHMARK_WITH_RAW(property_access);
+	ADD_BENCHMARK_WITH_RAW(object_pointer_register_get_set);
+	ADD_BENCHMARK_WITH_RAW(call_lua_function);
+	ADD_BENCHMARK_WITH_RAW(lua_table_access);
 
-	execute_benchmark(functionmap);
+#define ADD_BENCHMARK_PARAM(function, parameter) functionmap.push_back(parameterized_entry(#function,&function<parameter>,parameter));
+	ADD_BENCHMARK_PARAM(overload_resolution, 1);
+	ADD_BENCHMARK_PARAM(overload_resolution, 2);
+	ADD_BENCHMARK_PARAM(overload_resolution, 3);
+	ADD_BENCHMARK_PARAM(overload_resolution, 4);
+	ADD_BENCHMARK_PARAM(overload_resolution, 5);
+	ADD_BENCHMARK_PARAM(overload_resolution, 6);
+	ADD_BENCHMARK_PARAM(overload_resolution, 7);
+	ADD_BENCHMARK_PARAM(overload_resolution, 8);
+	ADD_BENCHMARK_PARAM(inheritance_depth, 1);
+	ADD_BENCHMARK_PARAM(inheritance_depth, 2);
+	ADD_BENCHMARK_PARAM(inheritance_depth, 3);
+	ADD_BENCHMARK_PARAM(inheritance_depth, 4);
+	ADD_BENCHMARK_PARAM(inheritance_depth, 5);
+	ADD_BENCHMARK_PARAM(inheritance_depth, 6);
+#define ADD_CONTAINER_BENCHMARK(function) \
+	ADD_BENCHMARK_PARAM(function, 10);\
+	ADD_BENCHMARK_PARAM(function, 100);\
+	ADD_BENCHMARK_PARAM(function, 1000);\
+	ADD_BENCHMARK_PARAM(function, 10000);\
+	ADD_BENCHMARK_PARAM(function, 100000);\
+	ADD_BENCHMARK_PARAM(function, 1000000);
+	ADD_CONTAINER_BENCHMARK(vector_to_lua);
+	ADD_CONTAINER_BENCHMARK(vector_from_lua);
+	ADD_CONTAINER_BENCHMARK(map_to_lua);
+	ADD_CONTAINER_BENCHMARK(map_from_lua);
+	ADD_BENCHMARK_PARAM(variadic_call, 1);
+	ADD_BENCHMARK_PARAM(variadic_call, 4);
+	ADD_BENCHMARK_PARAM(variadic_call, 16);
+	ADD_BENCHMARK(object_value_method);
+	ADD_BENCHMARK(object_pointer_method);
+	ADD_BENCHMARK(object_shared_ptr_method);
 
+	std::vector<BenchmarkResult> results;
+	for (benchmark_function_map_t::const_iterator it = functionmap.begin(); it != functionmap.end(); ++it)
+	{
+		if (!options.filter.empty() && it->name.find(options.filter) == std::string::npos)
+		{
+			continue;
+		}
+		BenchmarkResult result = execute_benchmark(it->name, it->function, options);
+		result.baseline = it->baseline;
+		result.family = it->family;
+		result.parameter = it->parameter;
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			if (!it->baseline.empty() && results[i].name == it->baseline && results[i].median > 0)
+			{
+				result.baseline_ratio = result.median / results[i].median;
+			}
+		}
+		results.push_back(result);
+	}
+	print_results(results, options);
 }
@@ -0,0 +1,80 @@
+#include <iostream>
+
+#include "kaguya/kaguya.hpp"
+#include "kaguya/footprint.hpp"
+
+#include "benchmark_function.hpp"
+
+//memory cost of objects held by Lua
+namespace
+{
+	struct Vec3
+	{
+		Vec3() :x(0), y(0), z(0) {}
+		float x, y, z;
+	};
+
+	const int OBJECT_COUNT = 100000;
+
+	size_t used_bytes(kaguya::State& state)
+	{
+		lua_gc(state.state(), LUA_GCCOLLECT, 0);
+		return size_t(lua_gc(state.state(), LUA_GCCOUNT, 0)) * 1024 + size_t(lua_gc(state.state(), LUA_GCCOUNTB, 0));
+	}
+
+	enum holder_type { HOLD_NONE, HOLD_VALUE, HOLD_POINTER, HOLD_SHARED_PTR };
+
+	//Lua heap bytes used by OBJECT_COUNT objects stored in a table
+	size_t heap_bytes(holder_type holder, std::vector<Vec3>& storage)
+	{
+		kaguya::State state;
+		state["Vec3"].setClass(kaguya::ClassMetatable<Vec3>()
+			.addConstructor()
+			);
+		state("objects = {}");
+		kaguya::LuaRef objects = state["objects"];
+		size_t before = used_bytes(state);
+		for (int i = 1; i <= OBJECT_COUNT; ++i)
+		{
+			switch (holder)
+			{
+			case HOLD_NONE: objects[i] = true; break;
+			case HOLD_VALUE: objects[i] = Vec3(); break;
+			case HOLD_POINTER: objects[i] = &storage[i - 1]; break;
+			case HOLD_SHARED_PTR: objects[i] = kaguya::standard::shared_ptr<Vec3>(new Vec3()); break;
+			}
+		}
+		return used_bytes(state) - before;
+	}
+}
+
+void print_footprint_report()
+{
+	kaguya::TypeFootprint type = kaguya::typeFootprint<Vec3>();
+	std::cout << "footprint of " << sizeof(Vec3) << " byte object:" << std::endl;
+	std::cout << "  userdata size: value " << type.value_wrapper_size << ", pointer " << type.pointer_wrapper_size
+		<< ", shared_ptr " << type.shared_ptr_wrapper_size << " (value overhead " << type.valueOverhead() << ")" << std::endl;
+	std::cout << "  bound function userdata size: " << kaguya::functorFootprint() << std::endl;
+
+	std::vector<Vec3> storage(OBJECT_COUNT);
+	size_t table_bytes = heap_bytes(HOLD_NONE, storage);
+	const char* names[] = { "value", "pointer", "shared_ptr" };
+	holder_type holders[] = { HOLD_VALUE, HOLD_POINTER, HOLD_SHARED_PTR };
+	for (int i = 0; i < 3; ++i)
+	{
+		size_t bytes = heap_bytes(holders[i], storage);
+		std::cout << "  Lua heap per object (" << names[i] << "): " << double(bytes - table_bytes) / OBJECT_COUNT << " bytes" << std::endl;
+	}
+
+	kaguya::State state;
+	state["Vec3"].setClass(kaguya::ClassMetatable<Vec3>()
+		.addConstructor()
+		);
+	state("objects = {} for i = 1,1000 do objects[i] = Vec3.new() end");
+	kaguya::UserdataFootprintMap footprint = kaguya::userdataFootprint(state.state());
+	std::cout << "live userdata after creating 1000 objects:" << std::endl;
+	for (kaguya::UserdataFootprintMap::const_iterator it = footprint.begin(); it != footprint.end(); ++it)
+	{
+		std::cout << "  " << it->first << ": " << it->second.count << " objects, " << it->second.bytes << " bytes" << std::endl;
+	}
+}
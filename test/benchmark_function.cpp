@@ -15,7 +15,7 @@
 	private:
 		double _i;
 	};
-	void simple_get_set(kaguya::State& state)
+	void simple_get_set(kaguya::State& state, int times)
 	{
 		state["SetGet"].setClass(kaguya::ClassMetatable<SetGet>()
 			.addConstructor()
@@ -23,10 +23,11 @@
 			.addMember("get", &SetGet::get)
 			);
 
+		state["times"] = times;
 		state(
 			"local getset = SetGet.new()\n"
 			//"getset={set = function(self,v) self.i = v end,get=function(self) return self.i end}\n"
-			"local times = 1000000\n"
+			"local times = times\n"
 			"for i=1,times do\n"
 			"getset:set(i)\n"
 			"if(getset:get() ~= i)then\n"
@@ -35,7 +36,7 @@
 			"end\n"
 			"");
 	}
-	void object_pointer_register_get_set(kaguya::State& state)
+	void object_pointer_register_get_set(kaguya::State& state, int times)
 	{
 		state["SetGet"].setClass(kaguya::ClassMetatable<SetGet>()
 			.addConstructor()
@@ -45,8 +46,9 @@
 
 		SetGet getset;
 		state["getset"] = &getset;
+		state["times"] = times;
 		state(
-			"local times = 1000000\n"
+			"local times = times\n"
 			"for i=1,times do\n"
 			"getset:set(i)\n"
 			"if(getset:get() ~= i)then\n"
@@ -56,22 +58,22 @@
 			);
 	}
 
-	void call_lua_function(kaguya::State& state)
+	void call_lua_function(kaguya::State& state, int times)
 	{
 		state("lua_function=function(i)return i;end");
 
 		kaguya::LuaRef lua_function = state["lua_function"];
-		for (int i = 0; i < 1000000; i++)
+		for (int i = 0; i < times; i++)
 		{
 			int r = lua_function(i);
 			if (r != i) { throw std::logic_error(""); }
 		}
 	}
-	void lua_table_access(kaguya::State& state)
+	void lua_table_access(kaguya::State& state, int times)
 	{
 		state("lua_table={value=0}");
 		kaguya::LuaRef lua_table = state["lua_table"];
-		for (int i = 0; i < 1000000; i++)
+		for (int i = 0; i < times; i++)
 		{
 			lua_table["value"] = i;
 			int v = lua_table["value"];
@@ -85,17 +87,18 @@
 
 		double d;
 	};
-	void property_access(kaguya::State& state)
+	void property_access(kaguya::State& state, int times)
 	{
 		state["Prop"].setClass(kaguya::ClassMetatable<Prop>()
 			.addConstructor()
 			.addProperty("d", &Prop::d)
 			);
 
+		state["times"] = times;
 		state(
 			"local getset = Prop.new()\n"
 			//"getset={set = function(self,v) self.i = v end,get=function(self) return self.i end}\n"
-			"local times = 1000000\n"
+			"local times = times\n"
 			"for i=1,times do\n"
 			"getset.d =i\n"
 			"if(getset.d ~= i)then\n"
@@ -1,9 +1,33 @@
 #pragma once
-void simple_get_set(kaguya::State& state);
-void object_pointer_register_get_set(kaguya::State& state);
+void simple_get_set(kaguya::State& state, int times);
+void object_pointer_register_get_set(kaguya::State& state, int times);
 
 
-void call_lua_function(kaguya::State& state);
-void lua_table_access(kaguya::State& state);
+void call_lua_function(kaguya::State& state, int times);
+void lua_table_access(kaguya::State& state, int times);
 
-void property_access(kaguya::State& state);
+void property_access(kaguya::State& state, int times);
+
+//raw Lua C API baseline (benchmark_raw.cpp)
+void simple_get_set_raw(kaguya::State& state, int times);
+void object_pointer_register_get_set_raw(kaguya::State& state, int times);
+void call_lua_function_raw(kaguya::State& state, int times);
+void lua_table_access_raw(kaguya::State& state, int times);
+void property_access_raw(kaguya::State& state, int times);
+
+//parameterized benchmarks (benchmark_matrix.cpp)
+//! call function with N overloads. matching overload is last candidate
+template<int N> void overload_resolution(kaguya::State& state, int times);
+//! call base class method on object Depth levels down inheritance chain
+template<int Depth> void inheritance_depth(kaguya::State& state, int times);
+template<int Size> void vector_to_lua(kaguya::State& state, int times);
+template<int Size> void vector_from_lua(kaguya::State& state, int times);
+template<int Size> void map_to_lua(kaguya::State& state, int times);
+template<int Size> void map_from_lua(kaguya::State& state, int times);
+template<int Args> void variadic_call(kaguya::State& state, int times);
+void object_value_method(kaguya::State& state, int times);
+void object_pointer_method(kaguya::State& state, int times);
+void object_shared_ptr_method(kaguya::State& state, int times);
+
+//! print memory cost of objects held by Lua (benchmark_footprint.cpp)
+void print_footprint_report();
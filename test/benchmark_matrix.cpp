@@ -0,0 +1,254 @@
+#include <sstream>
+#include <stdexcept>
+
+#include "kaguya/kaguya.hpp"
+
+#include "benchmark_function.hpp"
+
+//parameterized benchmarks. parameter is template argument and instantiated at end of file
+namespace
+{
+	void run(kaguya::State& state, const std::string& code)
+	{
+		if (!state(code))
+		{
+			throw std::logic_error("benchmark script failed");
+		}
+	}
+
+	//overload resolution
+	template<int N> struct OverloadTag
+	{
+		OverloadTag() :value(N) {}
+		int value;
+	};
+	template<int N> int overload_target(const OverloadTag<N>& tag)
+	{
+		return tag.value;
+	}
+	struct Overloads {};
+	//register overload_target<N> .. overload_target<1>. argument of OverloadTag<1> matches last candidate
+	template<int N> struct OverloadRegistrar
+	{
+		static void add(kaguya::ClassMetatable<Overloads>& metatable)
+		{
+			metatable.addStaticMember("f", &overload_target<N>);
+			OverloadRegistrar<N - 1>::add(metatable);
+		}
+	};
+	template<> struct OverloadRegistrar<0>
+	{
+		static void add(kaguya::ClassMetatable<Overloads>&) {}
+	};
+
+	//inheritance chain
+	template<int D> struct Level :Level<D - 1>
+	{
+	};
+	template<> struct Level<0>
+	{
+		Level() :value(1) {}
+		int get()const { return value; }
+		int value;
+	};
+	template<int D> struct LevelRegistrar
+	{
+		static void add(kaguya::State& state)
+		{
+			LevelRegistrar<D - 1>::add(state);
+			std::ostringstream name;
+			name << "Level" << D;
+			state[name.str()].setClass(kaguya::ClassMetatable<Level<D>, Level<D - 1> >());
+		}
+	};
+	template<> struct LevelRegistrar<0>
+	{
+		static void add(kaguya::State& state)
+		{
+			state["Level0"].setClass(kaguya::ClassMetatable<Level<0> >()
+				.addMember("get", &Level<0>::get)
+				);
+		}
+	};
+
+	std::vector<int> make_vector(int size)
+	{
+		std::vector<int> v(size);
+		for (int i = 0; i < size; ++i) { v[i] = i; }
+		return v;
+	}
+	std::map<int, int> make_map(int size)
+	{
+		std::map<int, int> m;
+		for (int i = 0; i < size; ++i) { m[i] = i; }
+		return m;
+	}
+
+	struct VariadicReceiver
+	{
+		static int count(kaguya::VariadicArgType args)
+		{
+			return int(args.size());
+		}
+	};
+
+	struct Holder
+	{
+		Holder() :value(1) {}
+		int get()const { return value; }
+		int value;
+	};
+	void register_holder(kaguya::State& state, int times)
+	{
+		state["Holder"].setClass(kaguya::ClassMetatable<Holder>()
+			.addConstructor()
+			.addMember("get", &Holder::get)
+			);
+		state["times"] = times;
+	}
+	const char* holder_script =
+		"local obj = obj\n"
+		"for i=1,times do\n"
+		"if obj:get() ~= 1 then error('error') end\n"
+		"end\n";
+}
+
+template<int N>
+void overload_resolution(kaguya::State& state, int times)
+{
+	kaguya::ClassMetatable<Overloads> metatable;
+	OverloadRegistrar<N>::add(metatable);
+	state["Overloads"].setClass(metatable);
+	state["Tag"].setClass(kaguya::ClassMetatable<OverloadTag<1> >());
+	state["tag"] = OverloadTag<1>();
+	state["times"] = times;
+	run(state,
+		"local f = Overloads.f\n"
+		"local tag = tag\n"
+		"for i=1,times do\n"
+		"if f(tag) ~= 1 then error('error') end\n"
+		"end\n");
+}
+
+template<int Depth>
+void inheritance_depth(kaguya::State& state, int times)
+{
+	LevelRegistrar<Depth>::add(state);
+	state["obj"] = Level<Depth>();
+	state["times"] = times;
+	run(state,
+		"local obj = obj\n"
+		"for i=1,times do\n"
+		"if obj:get() ~= 1 then error('error') end\n"
+		"end\n");
+}
+
+template<int Size>
+void vector_to_lua(kaguya::State& state, int times)
+{
+	std::vector<int> v = make_vector(Size);
+	for (int i = 0; i < times; ++i)
+	{
+		state["v"] = v;
+	}
+}
+template<int Size>
+void vector_from_lua(kaguya::State& state, int times)
+{
+	state["v"] = make_vector(Size);
+	kaguya::LuaRef table = state["v"];
+	for (int i = 0; i < times; ++i)
+	{
+		std::vector<int> v = table;
+		if (int(v.size()) != Size) { throw std::logic_error(""); }
+	}
+}
+template<int Size>
+void map_to_lua(kaguya::State& state, int times)
+{
+	std::map<int, int> m = make_map(Size);
+	for (int i = 0; i < times; ++i)
+	{
+		state["m"] = m;
+	}
+}
+template<int Size>
+void map_from_lua(kaguya::State& state, int times)
+{
+	state["m"] = make_map(Size);
+	kaguya::LuaRef table = state["m"];
+	for (int i = 0; i < times; ++i)
+	{
+		std::map<int, int> m = table;
+		if (int(m.size()) != Size) { throw std::logic_error(""); }
+	}
+}
+
+template<int Args>
+void variadic_call(kaguya::State& state, int times)
+{
+	state["Variadic"].setClass(kaguya::ClassMetatable<VariadicReceiver>()
+		.addStaticMember("count", &VariadicReceiver::count)
+		);
+	state["times"] = times;
+	std::ostringstream code;
+	code << "local count = Variadic.count\nfor i=1,times do\nif count(";
+	for (int i = 0; i < Args; ++i)
+	{
+		code << (i ? "," : "") << i;
+	}
+	code << ") ~= " << Args << " then error('error') end\nend\n";
+	run(state, code.str());
+}
+
+void object_value_method(kaguya::State& state, int times)
+{
+	register_holder(state, times);
+	state["obj"] = Holder();
+	run(state, holder_script);
+}
+void object_pointer_method(kaguya::State& state, int times)
+{
+	register_holder(state, times);
+	Holder holder;
+	state["obj"] = &holder;
+	run(state, holder_script);
+}
+void object_shared_ptr_method(kaguya::State& state, int times)
+{
+	register_holder(state, times);
+	state["obj"] = kaguya::standard::shared_ptr<Holder>(new Holder());
+	run(state, holder_script);
+}
+
+template void overload_resolution<1>(kaguya::State&, int);
+template void overload_resolution<2>(kaguya::State&, int);
+template void overload_resolution<3>(kaguya::State&, int);
+template void overload_resolution<4>(kaguya::State&, int);
+template void overload_resolution<5>(kaguya::State&, int);
+template void overload_resolution<6>(kaguya::State&, int);
+template void overload_resolution<7>(kaguya::State&, int);
+template void overload_resolution<8>(kaguya::State&, int);
+
+template void inheritance_depth<1>(kaguya::State&, int);
+template void inheritance_depth<2>(kaguya::State&, int);
+template void inheritance_depth<3>(kaguya::State&, int);
+template void inheritance_depth<4>(kaguya::State&, int);
+template void inheritance_depth<5>(kaguya::State&, int);
+template void inheritance_depth<6>(kaguya::State&, int);
+
+#define KAGUYA_BENCHMARK_CONTAINER_SIZES(function) \
+	template void function<10>(kaguya::State&, int);\
+	template void function<100>(kaguya::State&, int);\
+	template void function<1000>(kaguya::State&, int);\
+	template void function<10000>(kaguya::State&, int);\
+	template void function<100000>(kaguya::State&, int);\
+	template void function<1000000>(kaguya::State&, int);
+KAGUYA_BENCHMARK_CONTAINER_SIZES(vector_to_lua)
+KAGUYA_BENCHMARK_CONTAINER_SIZES(vector_from_lua)
+KAGUYA_BENCHMARK_CONTAINER_SIZES(map_to_lua)
+KAGUYA_BENCHMARK_CONTAINER_SIZES(map_from_lua)
+
+template void variadic_call<1>(kaguya::State&, int);
+template void variadic_call<4>(kaguya::State&, int);
+template void variadic_call<16>(kaguya::State&, int);
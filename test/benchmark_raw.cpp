@@ -0,0 +1,237 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "kaguya/kaguya.hpp"
+
+#include "benchmark_function.hpp"
+
+//hand written Lua C API implementation of benchmark_function.cpp. baseline of binding overhead
+namespace
+{
+	class SetGet
+	{
+	public:
+		SetGet() :_i(0.0) {}
+		void set(double i)
+		{
+			_i = i;
+		}
+		double get()const
+		{
+			return _i;
+		}
+	private:
+		double _i;
+	};
+
+	const char* SETGET_NAME = "raw_SetGet";
+	const char* SETGET_PTR_NAME = "raw_SetGetPtr";
+	const char* PROP_NAME = "raw_Prop";
+
+	int setget_new(lua_State* l)
+	{
+		void* storage = lua_newuserdata(l, sizeof(SetGet));
+		new(storage) SetGet();
+		luaL_getmetatable(l, SETGET_NAME);
+		lua_setmetatable(l, -2);
+		return 1;
+	}
+	int setget_set(lua_State* l)
+	{
+		SetGet* self = static_cast<SetGet*>(luaL_checkudata(l, 1, SETGET_NAME));
+		self->set(luaL_checknumber(l, 2));
+		return 0;
+	}
+	int setget_get(lua_State* l)
+	{
+		SetGet* self = static_cast<SetGet*>(luaL_checkudata(l, 1, SETGET_NAME));
+		lua_pushnumber(l, self->get());
+		return 1;
+	}
+	int setget_ptr_set(lua_State* l)
+	{
+		SetGet* self = *static_cast<SetGet**>(luaL_checkudata(l, 1, SETGET_PTR_NAME));
+		self->set(luaL_checknumber(l, 2));
+		return 0;
+	}
+	int setget_ptr_get(lua_State* l)
+	{
+		SetGet* self = *static_cast<SetGet**>(luaL_checkudata(l, 1, SETGET_PTR_NAME));
+		lua_pushnumber(l, self->get());
+		return 1;
+	}
+
+	//create metatable with __index table of methods and leave it on stack
+	void new_method_metatable(lua_State* l, const char* name, lua_CFunction set, lua_CFunction get)
+	{
+		luaL_newmetatable(l, name);
+		lua_newtable(l);
+		lua_pushcfunction(l, set);
+		lua_setfield(l, -2, "set");
+		lua_pushcfunction(l, get);
+		lua_setfield(l, -2, "get");
+		lua_setfield(l, -2, "__index");
+	}
+
+	void run(lua_State* l, const char* code)
+	{
+		if (luaL_dostring(l, code))
+		{
+			std::string message = lua_tostring(l, -1);
+			lua_pop(l, 1);
+			throw std::logic_error(message);
+		}
+	}
+
+	struct Prop
+	{
+		Prop() :d(0) {}
+
+		double d;
+	};
+	int prop_new(lua_State* l)
+	{
+		void* storage = lua_newuserdata(l, sizeof(Prop));
+		new(storage) Prop();
+		luaL_getmetatable(l, PROP_NAME);
+		lua_setmetatable(l, -2);
+		return 1;
+	}
+	int prop_index(lua_State* l)
+	{
+		Prop* self = static_cast<Prop*>(luaL_checkudata(l, 1, PROP_NAME));
+		const char* key = luaL_checkstring(l, 2);
+		if (std::strcmp(key, "d") == 0)
+		{
+			lua_pushnumber(l, self->d);
+			return 1;
+		}
+		return 0;
+	}
+	int prop_newindex(lua_State* l)
+	{
+		Prop* self = static_cast<Prop*>(luaL_checkudata(l, 1, PROP_NAME));
+		const char* key = luaL_checkstring(l, 2);
+		if (std::strcmp(key, "d") == 0)
+		{
+			self->d = luaL_checknumber(l, 3);
+			return 0;
+		}
+		return luaL_error(l, "unknown property %s", key);
+	}
+}
+
+void simple_get_set_raw(kaguya::State& state, int times)
+{
+	lua_State* l = state.state();
+	new_method_metatable(l, SETGET_NAME, &setget_set, &setget_get);
+	lua_pop(l, 1);
+	lua_newtable(l);
+	lua_pushcfunction(l, &setget_new);
+	lua_setfield(l, -2, "new");
+	lua_setglobal(l, "SetGet");
+	lua_pushinteger(l, times);
+	lua_setglobal(l, "times");
+
+	run(l,
+		"local getset = SetGet.new()\n"
+		"local times = times\n"
+		"for i=1,times do\n"
+		"getset:set(i)\n"
+		"if(getset:get() ~= i)then\n"
+		"error('error')\n"
+		"end\n"
+		"end\n"
+		"");
+}
+void object_pointer_register_get_set_raw(kaguya::State& state, int times)
+{
+	lua_State* l = state.state();
+	SetGet getset;
+	*static_cast<SetGet**>(lua_newuserdata(l, sizeof(SetGet*))) = &getset;
+	new_method_metatable(l, SETGET_PTR_NAME, &setget_ptr_set, &setget_ptr_get);
+	lua_setmetatable(l, -2);
+	lua_setglobal(l, "getset");
+	lua_pushinteger(l, times);
+	lua_setglobal(l, "times");
+
+	run(l,
+		"local times = times\n"
+		"for i=1,times do\n"
+		"getset:set(i)\n"
+		"if(getset:get() ~= i)then\n"
+		"error('error')\n"
+		"end\n"
+		"end\n"
+		);
+}
+void call_lua_function_raw(kaguya::State& state, int times)
+{
+	lua_State* l = state.state();
+	run(l, "lua_function=function(i)return i;end");
+
+	lua_getglobal(l, "lua_function");
+	int function_ref = luaL_ref(l, LUA_REGISTRYINDEX);
+	for (int i = 0; i < times; i++)
+	{
+		lua_rawgeti(l, LUA_REGISTRYINDEX, function_ref);
+		lua_pushinteger(l, i);
+		if (lua_pcall(l, 1, 1, 0))
+		{
+			throw std::logic_error(lua_tostring(l, -1));
+		}
+		int r = int(lua_tointeger(l, -1));
+		lua_pop(l, 1);
+		if (r != i) { throw std::logic_error(""); }
+	}
+	luaL_unref(l, LUA_REGISTRYINDEX, function_ref);
+}
+void lua_table_access_raw(kaguya::State& state, int times)
+{
+	lua_State* l = state.state();
+	run(l, "lua_table={value=0}");
+
+	lua_getglobal(l, "lua_table");
+	int table_ref = luaL_ref(l, LUA_REGISTRYINDEX);
+	for (int i = 0; i < times; i++)
+	{
+		lua_rawgeti(l, LUA_REGISTRYINDEX, table_ref);
+		lua_pushinteger(l, i);
+		lua_setfield(l, -2, "value");
+		lua_pop(l, 1);
+
+		lua_rawgeti(l, LUA_REGISTRYINDEX, table_ref);
+		lua_getfield(l, -1, "value");
+		int v = int(lua_tointeger(l, -1));
+		lua_pop(l, 2);
+		if (v != i) { throw std::logic_error(""); }
+	}
+	luaL_unref(l, LUA_REGISTRYINDEX, table_ref);
+}
+void property_access_raw(kaguya::State& state, int times)
+{
+	lua_State* l = state.state();
+	luaL_newmetatable(l, PROP_NAME);
+	lua_pushcfunction(l, &prop_index);
+	lua_setfield(l, -2, "__index");
+	lua_pushcfunction(l, &prop_newindex);
+	lua_setfield(l, -2, "__newindex");
+	lua_pop(l, 1);
+	lua_newtable(l);
+	lua_pushcfunction(l, &prop_new);
+	lua_setfield(l, -2, "new");
+	lua_setglobal(l, "Prop");
+	lua_pushinteger(l, times);
+	lua_setglobal(l, "times");
+
+	run(l,
+		"local getset = Prop.new()\n"
+		"local times = times\n"
+		"for i=1,times do\n"
+		"getset.d =i\n"
+		"if(getset.d ~= i)then\n"
+		"error('error')\n"
+		"end\n"
+		"end\n"
+		"");
+}
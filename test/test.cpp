@@ -2,9 +2,27 @@
 #include <cassert>
 
 #include "kaguya/kaguya.hpp"
+#include "kaguya/scheduler.hpp"
+#include "kaguya/async.hpp"
+#include "kaguya/chunk_registry.hpp"
+#include "kaguya/state_pool.hpp"
+#include "kaguya/executor.hpp"
+#include "kaguya/serializer.hpp"
+#include "kaguya/bytecode_cache.hpp"
+#include "kaguya/mapped_file.hpp"
+#include "kaguya/message_queue.hpp"
+#include "kaguya/gc_controller.hpp"
+#include "kaguya/execution_budget.hpp"
+#include "kaguya/profiler.hpp"
+#include "kaguya/footprint.hpp"
+#if KAGUYA_USE_CPP11
+#include <thread>
+#endif
 
 
 
+void test_error_handler(int status, const char* message);
+
 #define TEST_CHECK(B) if(!(B)) throw std::runtime_error( std::string("failed.\nfunction:") +__FUNCTION__  + std::string("\nline:") + kaguya::standard::to_string(__LINE__) + "\nCHECKCODE:" #B );
 namespace t_01_primitive
 {
@@ -79,6 +97,16 @@ namespace t_01_primitive
 	};
 }
 
+namespace t_02_classreg
+{
+	struct NamedType
+	{
+		NamedType() :value(7) {}
+		int value;
+	};
+}
+KAGUYA_TYPE_NAME(t_02_classreg::NamedType, "NamedType")
+
 namespace t_02_classreg
 {
 	struct ABC
@@ -475,6 +503,64 @@ namespace t_02_classreg
 		TEST_CHECK(state("assert(3 == derived.b)"));
 		TEST_CHECK(derived.b == 3);
 	}
+	void type_name(kaguya::State& state)
+	{
+		TEST_CHECK(std::string(kaguya::metatableName<NamedType>()) == KAGUYA_METATABLE_PREFIX "NamedType");
+		TEST_CHECK(std::string(kaguya::util::typeName<NamedType>()) == "NamedType");
+		TEST_CHECK(std::string(kaguya::util::typeName<Base>()).find("Base") != std::string::npos);
+		TEST_CHECK(kaguya::metatableType<const Base*>() == kaguya::metatableType<Base>());
+		TEST_CHECK(kaguya::metatableType<Base>() != kaguya::metatableType<Derived>());
+
+		state["NamedType"].setClass(kaguya::ClassMetatable<NamedType>()
+			.addConstructor()
+			.addMember("value", &NamedType::value)
+			);
+		state["named"] = NamedType();
+		TEST_CHECK(state("assert(getmetatable(named).__name == 'kaguya_object_type_NamedType')"));
+		TEST_CHECK(state("assert(named:value() == 7)"));
+		const NamedType* named = state["named"];
+		TEST_CHECK(named && named->value == 7);
+	}
+#if KAGUYA_ENABLE_INSTRUMENTATION
+	void instrumentation(kaguya::State& state)
+	{
+		state["ABC"].setClass(kaguya::ClassMetatable<ABC>()
+			.addConstructor<int>()
+			.addMember("getInt", &ABC::getInt)
+			.addMember("setInt", &ABC::setInt)
+			);
+		kaguya::instrumentation::Registry::instance().reset();
+		TEST_CHECK(state("value = ABC.new(3) for i = 1,10 do value:getInt() end"));
+		TEST_CHECK(!state("value:setInt('abc')"));
+
+		std::vector<kaguya::instrumentation::BindingStatsSnapshot> snapshot = kaguya::instrumentation::Registry::instance().snapshot();
+		bool found_get = false;
+		bool found_set = false;
+		for (size_t i = 0; i < snapshot.size(); ++i)
+		{
+			if (snapshot[i].class_name != kaguya::util::typeName<ABC>())
+			{
+				continue;
+			}
+			if (snapshot[i].member_name == "getInt")
+			{
+				found_get = true;
+				TEST_CHECK(snapshot[i].calls == 10);
+				TEST_CHECK(snapshot[i].overload_failures == 0);
+				unsigned long long histogram_total = 0;
+				for (int b = 0; b < kaguya::instrumentation::LATENCY_BUCKETS; ++b) { histogram_total += snapshot[i].latency_histogram[b]; }
+				TEST_CHECK(histogram_total == 10);
+			}
+			else if (snapshot[i].member_name == "setInt")
+			{
+				found_set = true;
+				TEST_CHECK(snapshot[i].calls == 0);
+				TEST_CHECK(snapshot[i].overload_failures == 1);
+			}
+		}
+		TEST_CHECK(found_get && found_set);
+	}
+#endif
 	
 }
 
@@ -726,6 +812,30 @@ namespace t_03_function
 	}
 #endif
 
+#if KAGUYA_USE_VARIADIC_TEMPLATE
+	int sum_many(int a1, int a2, int a3, int a4, int a5, int a6, int a7, int a8, int a9, int a10, int a11, int a12)
+	{
+		return a1 + a2 + a3 + a4 + a5 + a6 + a7 + a8 + a9 + a10 + a11 + a12;
+	}
+	struct WideConstructor
+	{
+		WideConstructor(int a1, int a2, int a3, int a4, int a5, int a6, int a7, int a8, int a9, int a10, int a11)
+			:total(a1 + a2 + a3 + a4 + a5 + a6 + a7 + a8 + a9 + a10 + a11) {}
+		int total;
+	};
+	void many_arguments(kaguya::State& state)
+	{
+		state["sum_many"] = kaguya::function(&sum_many);
+		TEST_CHECK(state("assert(sum_many(1,2,3,4,5,6,7,8,9,10,11,12) == 78)"));
+
+		state["WideConstructor"].setClass(kaguya::ClassMetatable<WideConstructor>()
+			.addConstructor<int, int, int, int, int, int, int, int, int, int, int>()
+			.addMember("total", &WideConstructor::total)
+			);
+		TEST_CHECK(state("assert(WideConstructor.new(1,2,3,4,5,6,7,8,9,10,11):total() == 66)"));
+	}
+#endif
+
 	enum TestEnum
 	{
 		Fooe = 0,
@@ -1010,7 +1120,54 @@ namespace t_04_lua_ref
 
 	}
 
-
+	void try_get(kaguya::State& state)
+	{
+		state["NamedType"].setClass(kaguya::ClassMetatable<t_02_classreg::NamedType>()
+			.addConstructor()
+			);
+		TEST_CHECK(state("number = 3 text = 'abc' flag = true object = NamedType.new()"));
+
+		kaguya::optional<int> number = state["number"].tryGet<int>();
+		TEST_CHECK(number && *number == 3);
+		TEST_CHECK(!state["text"].tryGet<int>());
+		TEST_CHECK(!state["missing"].tryGet<std::string>());
+		TEST_CHECK(state["text"].tryGet<std::string>().value_or("") == "abc");
+		TEST_CHECK(!kaguya::LuaRef().tryGet<int>());
+
+		kaguya::optional<const t_02_classreg::NamedType&> object = state["object"].tryGet<const t_02_classreg::NamedType&>();
+		TEST_CHECK(object && object->value == 7);
+		TEST_CHECK(!state["object"].tryGet<const t_02_classreg::ABC&>());
+		TEST_CHECK(!state["number"].tryGet<t_02_classreg::NamedType>());
+
+		TEST_CHECK(state["text"].getOr<int>(5) == 5);
+		TEST_CHECK(state["number"].getOr<int>(5) == 3);
+		TEST_CHECK(state["number"].getOr<std::string>("none") == "3");
+		TEST_CHECK(state["object"].getOr<std::string>("none") == "none");
+
+		//comparison with wrong type is false without exception
+		TEST_CHECK(!(state["text"] == 3));
+		TEST_CHECK(state["text"] != 3);
+		TEST_CHECK(!(state["number"] == "abc"));
+		TEST_CHECK(state["number"] == 3);
+		TEST_CHECK(state["text"] == std::string("abc"));
+
+		//weak type check of container accepts any object element. tryGet must check element type
+		state["ABC"].setClass(kaguya::ClassMetatable<t_02_classreg::ABC>()
+			.addConstructor<int>()
+			);
+		TEST_CHECK(state("objects = {NamedType.new(), ABC.new(1)} abcs = {ABC.new(1), ABC.new(2)} named = {key = ABC.new(3)} numbers = {1, 2, 'x'}"));
+		TEST_CHECK(!state["objects"].tryGet<std::vector<t_02_classreg::ABC> >());
+		TEST_CHECK(state["objects"].getOr<std::vector<t_02_classreg::ABC> >(std::vector<t_02_classreg::ABC>()).empty());
+		kaguya::optional<std::vector<t_02_classreg::ABC> > abcs = state["abcs"].tryGet<std::vector<t_02_classreg::ABC> >();
+		TEST_CHECK(abcs && abcs->size() == 2);
+		typedef std::map<std::string, t_02_classreg::NamedType> named_map;
+		typedef std::map<std::string, t_02_classreg::ABC> abc_map;
+		TEST_CHECK(!state["named"].tryGet<named_map>());
+		kaguya::optional<abc_map> named = state["named"].tryGet<abc_map>();
+		TEST_CHECK(named && named->size() == 1 && (*named)["key"].intmember == 3);
+		TEST_CHECK(!state["numbers"].tryGet<std::vector<int> >());
+		TEST_CHECK(!(state["objects"] == abcs.value()));
+	}
 }
 
 namespace t_05_error_handler
@@ -1020,6 +1177,12 @@ namespace t_05_error_handler
 	{
 		error_count++;
 	}
+	struct CountingHandler
+	{
+		CountingHandler(int& count) :count_(count) {}
+		void operator()(int status, const char* message) { count_++; }
+		int& count_;
+	};
 	void set_error_function(kaguya::State& state)
 	{
 		error_count = 0;
@@ -1040,6 +1203,61 @@ namespace t_05_error_handler
 
 		TEST_CHECK(error_count == 1);
 	}
+	void handler_per_state(kaguya::State& state)
+	{
+		error_count = 0;
+		state.setErrorHandler(error_fun);
+
+		//wrapper of same lua_State shares handler
+		kaguya::State wrapper(state.state());
+		TEST_CHECK(!wrapper("error('from wrapper')"));
+		TEST_CHECK(error_count == 1);
+
+		//coroutine thread uses handler of main thread
+		kaguya::LuaThread thread_ref = state.newThread();
+		lua_State* thread = thread_ref.get<lua_State*>();
+		kaguya::ErrorHandler::instance().handle("from thread", thread);
+		TEST_CHECK(error_count == 2);
+
+		//handler is per state
+		kaguya::State other;
+		int other_count = 0;
+		other.setErrorHandler(CountingHandler(other_count));
+		TEST_CHECK(!other("error('other')"));
+		TEST_CHECK(other_count == 1 && error_count == 2);
+
+		//replaced handler is used by existing threads
+		state.setErrorHandler(CountingHandler(other_count));
+		kaguya::ErrorHandler::instance().handle("from thread", thread);
+		TEST_CHECK(other_count == 2 && error_count == 2);
+	}
+
+	kaguya::State* replacing_state = 0;
+	int replaced_count = 0;
+	void replaced_handler(int status, const char* message)
+	{
+		replaced_count += 10;
+	}
+	struct ReplacingHandler
+	{
+		std::string calls;
+		void operator()(int status, const char* message)
+		{
+			replacing_state->setErrorHandler(replaced_handler);
+			calls += "called";//replaced handler object must be alive until return
+			replaced_count++;
+		}
+	};
+	void handler_replaces_itself(kaguya::State& state)
+	{
+		replacing_state = &state;
+		replaced_count = 0;
+		state.setErrorHandler(ReplacingHandler());
+		TEST_CHECK(!state("error('first')"));
+		TEST_CHECK(replaced_count == 1);
+		TEST_CHECK(!state("error('second')"));
+		TEST_CHECK(replaced_count == 11);
+	}
 }
 
 namespace t_06_state
@@ -1108,6 +1326,500 @@ namespace t_06_state
 			TEST_CHECK(state("assert(true)"));
 			TEST_CHECK(state("assert(math.abs(-2) == 2)"));
 		}
+#endif
+	}
+	void allocator_constructor(kaguya::State&)
+	{
+		{
+			kaguya::State state(kaguya::standard::shared_ptr<kaguya::PoolAllocator>(new kaguya::PoolAllocator()));
+			state.setErrorHandler(test_error_handler);
+			TEST_CHECK(state("local t = {} for i = 1,10000 do t[i] = tostring(i) end assert(#t == 10000)"));
+			TEST_CHECK(state("t = nil collectgarbage()"));
+		}
+		{
+			kaguya::standard::shared_ptr<kaguya::ArenaAllocator> arena(new kaguya::ArenaAllocator());
+			{
+				kaguya::State state(kaguya::NoLoadLib(), arena);
+				state.setErrorHandler(test_error_handler);
+				TEST_CHECK(state("local s = '' for i = 1,100 do s = s .. i end value = s"));
+				TEST_CHECK(state["value"] == "123456789101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899100");
+			}
+			TEST_CHECK(arena->reservedBytes() > 0);
+		}
+	}
+	int recorded_error_status = 0;
+	void record_error_handler(int status, const char*)
+	{
+		recorded_error_status = status;
+	}
+	void memory_limit(kaguya::State&)
+	{
+		typedef kaguya::AccountingAllocator<> allocator_type;
+		kaguya::standard::shared_ptr<allocator_type> allocator(new allocator_type());
+		kaguya::State state(allocator);
+		const kaguya::MemoryStats& stats = allocator->stats();
+		TEST_CHECK(stats.current_bytes > 0);
+		TEST_CHECK(stats.peak_bytes >= stats.current_bytes);
+		TEST_CHECK(stats.allocation_count > 0);
+		TEST_CHECK(stats.total_allocated_bytes >= stats.peak_bytes);
+
+		allocator->setLimit(stats.current_bytes + 256 * 1024);
+		state.setErrorHandler(record_error_handler);
+		TEST_CHECK(!state("local t = {} for i = 1,1000000 do t[i] = i end"));
+		TEST_CHECK(recorded_error_status == LUA_ERRMEM);
+		TEST_CHECK(stats.failure_count > 0);
+		TEST_CHECK(stats.current_bytes <= allocator->limit());
+
+		allocator->setLimit(0);
+		state.setErrorHandler(test_error_handler);
+		TEST_CHECK(state("collectgarbage() local t = {} for i = 1,100000 do t[i] = i end"));
+
+		kaguya::standard::shared_ptr<allocator_type> exhausted(new allocator_type());
+		exhausted->setLimit(1);
+		bool thrown = false;
+		try
+		{
+			kaguya::State failed(exhausted);
+		}
+		catch (const kaguya::LuaMemoryError&)
+		{
+			thrown = true;
+		}
+		TEST_CHECK(thrown);
+	}
+	void write_file(const char* path, const std::string& content)
+	{
+		std::ofstream ofs(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		ofs << content;
+	}
+	void bytecode_cache(kaguya::State& state)
+	{
+		const char* script = "kaguya_bytecode_cache_test.lua";
+		write_file(script, "value = (value or 0) + 1");
+
+		kaguya::standard::shared_ptr<kaguya::BytecodeCache> cache(new kaguya::BytecodeCache("."));
+		state.setFileLoader(cache);
+		TEST_CHECK(state.fileLoader() == cache);
+		TEST_CHECK(state.dofile(script));
+		TEST_CHECK(state.dofile(script));
+		TEST_CHECK(state["value"] == 2);
+		TEST_CHECK(cache->missCount() == 1);
+		TEST_CHECK(cache->hitCount() == 1);
+
+		kaguya::LuaFunction f = state.loadfile(script);
+		f();
+		TEST_CHECK(state["value"] == 3);
+		TEST_CHECK(cache->hitCount() == 2);
+
+		{//load from disk
+			kaguya::standard::shared_ptr<kaguya::BytecodeCache> disk_cache(new kaguya::BytecodeCache("."));
+			kaguya::State other;
+			other.setFileLoader(disk_cache);
+			TEST_CHECK(other.dofile(script));
+			TEST_CHECK(other["value"] == 1);
+			TEST_CHECK(disk_cache->hitCount() == 1);
+			TEST_CHECK(disk_cache->missCount() == 0);
+		}
+
+		write_file(script, "value = (value or 0) + 10");//size changed
+		TEST_CHECK(state.dofile(script));
+		TEST_CHECK(state["value"] == 13);
+		TEST_CHECK(cache->missCount() == 2);
+
+		cache->setVerifyHash(true);
+		cache->setStripDebugInfo(true);
+		TEST_CHECK(state.dofile(script));
+		TEST_CHECK(state.dofile(script));
+		TEST_CHECK(state["value"] == 33);
+		TEST_CHECK(cache->missCount() == 3);
+
+		cache->erase(script);
+		std::remove(script);
+		state.setErrorHandler(ignore_error_fun);
+		TEST_CHECK(!state.dofile(script));
+		TEST_CHECK(cache->size() == 0);
+	}
+	std::string recorded_error_message;
+	void record_error_message(int status, const char* message)
+	{
+		recorded_error_message = message ? message : "";
+	}
+	void mapped_loadfile(kaguya::State& state)
+	{
+		const char* script = "kaguya_mapped_loadfile_test.lua";
+		write_file(script, "\xEF\xBB\xBF#!/usr/bin/env lua\nvalue = 'mapped'");
+		state.setFileLoader(kaguya::standard::shared_ptr<kaguya::FileLoader>(new kaguya::MappedFileLoader()));
+		TEST_CHECK(state.dofile(script));
+		TEST_CHECK(state["value"] == "mapped");
+
+		write_file(script, "#!/usr/bin/env lua\nerror('line2')");
+		state.setErrorHandler(record_error_message);
+		TEST_CHECK(!state.dofile(script));
+		TEST_CHECK(recorded_error_message.find("kaguya_mapped_loadfile_test.lua:2:") != std::string::npos);
+
+		write_file(script, "");
+		TEST_CHECK(!state.loadfile(script).isNilref());
+		std::remove(script);
+		TEST_CHECK(state.loadfile(script).isNilref());
+	}
+	void pool_setup(kaguya::State& state)
+	{
+		state("counter = 0 function increment() counter = counter + 1 return counter end");
+	}
+	void state_pool(kaguya::State&)
+	{
+		kaguya::StatePool pool(2, pool_setup);
+		TEST_CHECK(pool.idleCount() == 2);
+		TEST_CHECK(pool.createdCount() == 2);
+		lua_State* first = 0;
+		{
+			kaguya::StatePool::StatePtr state = pool.acquire();
+			first = state->state();
+			TEST_CHECK(pool.idleCount() == 1);
+			TEST_CHECK((*state)("assert(increment() == 1) temporary = 1 increment = nil package.loaded.temp = {}"));
+		}
+		TEST_CHECK(pool.idleCount() == 2);
+		{
+			kaguya::StatePool::StatePtr a = pool.acquire();
+			kaguya::StatePool::StatePtr b = pool.acquire();
+			kaguya::StatePool::StatePtr c = pool.acquire();
+			TEST_CHECK(pool.createdCount() == 3);
+			kaguya::StatePool::StatePtr restored = a->state() == first ? a : b;
+			TEST_CHECK((*restored)("assert(counter == 0) assert(increment() == 1) assert(temporary == nil) assert(package.loaded.temp == nil)"));
+			kaguya::StatePool::markTainted(c);
+		}
+		TEST_CHECK(pool.idleCount() == 2);
+		TEST_CHECK(pool.discardedCount() == 1);
+
+		pool.setMaxUses(1);
+		{
+			kaguya::StatePool::StatePtr state = pool.acquire();
+		}
+		TEST_CHECK(pool.discardedCount() == 2);
+		TEST_CHECK(pool.idleCount() == 1);
+
+		pool.setMaxUses(0);
+		{
+			kaguya::StatePool::StatePtr state = pool.acquire();
+			TEST_CHECK((*state)("string.tainted = true"));//changes inside of tables are not restored
+			kaguya::StatePool::markTainted(state);
+		}
+		TEST_CHECK(pool.discardedCount() == 3);
+		{
+			kaguya::StatePool::StatePtr state = pool.acquire();
+			TEST_CHECK((*state)("assert(string.tainted == nil)"));
+		}
+		TEST_CHECK(pool.discardedCount() == 3);
+
+		lua_State* replaced = 0;
+		{//metatables of _G and string are reset
+			kaguya::StatePool::StatePtr state = pool.acquire();
+			replaced = state->state();
+			TEST_CHECK((*state)("setmetatable(_G, { __index = function() return 1 end }) debug.setmetatable('', {})"));
+		}
+		{
+			kaguya::StatePool::StatePtr state = pool.acquire();
+			TEST_CHECK(state->state() == replaced);
+			TEST_CHECK((*state)("assert(getmetatable(_G) == nil and undefined_global == nil) assert(('x'):upper() == 'X')"));
+		}
+
+		//leaked registry references count toward repair limit
+		pool.setMaxRepairs(2);
+		{
+			kaguya::StatePool::StatePtr state = pool.acquire();
+			for (int i = 0; i < 3; ++i)
+			{
+				lua_newtable(state->state());
+				luaL_ref(state->state(), LUA_REGISTRYINDEX);
+			}
+		}
+		TEST_CHECK(pool.discardedCount() == 4);
+
+		kaguya::StatePool::StatePtr unpooled(new kaguya::State());
+		kaguya::StatePool::markTainted(unpooled);
+	}
+#if KAGUYA_USE_CPP11 && KAGUYA_USE_VARIADIC_TEMPLATE
+	void executor(kaguya::State&)
+	{
+		kaguya::Executor executor(3, [](kaguya::State& state)
+		{
+			state("function square(x) return x * x end function fail() error('job error') end");
+		});
+		TEST_CHECK(executor.size() == 3);
+
+		std::vector<std::future<int> > results;
+		for (int i = 0; i < 100; ++i)
+		{
+			results.push_back(executor.call<int>("square", i));
+		}
+		int sum = 0;
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			sum += results[i].get();
+		}
+		TEST_CHECK(sum == 328350);
+
+		std::future<std::string> version = executor.submit([](kaguya::State& state) -> std::string
+		{
+			return state["_VERSION"];
+		});
+		TEST_CHECK(version.get().find("Lua") == 0);
+
+		std::future<void> failed = executor.call<void>("fail");
+		bool thrown = false;
+		try
+		{
+			failed.get();
+		}
+		catch (const kaguya::LuaException& e)
+		{
+			thrown = std::string(e.what()).find("job error") != std::string::npos;
+		}
+		TEST_CHECK(thrown);
+	}
+#endif
+#if KAGUYA_USE_CPP11
+	void message_queue(kaguya::State& state)
+	{
+		kaguya::MessageQueue queue;
+		TEST_CHECK(state("received = {} count = 0 function on_message(m) received[#received + 1] = m end"));
+		{
+			kaguya::State producer;
+			TEST_CHECK(producer("message = { id = 1, text = 'hello' }"));
+			TEST_CHECK(queue.postValue(producer["message"]));
+		}
+		std::vector<std::thread> producers;
+		for (int t = 0; t < 4; ++t)
+		{
+			producers.push_back(std::thread([&queue]()
+			{
+				for (int i = 0; i < 250; ++i)
+				{
+					queue.post([](lua_State* l) { luaL_dostring(l, "count = count + 1"); });
+				}
+			}));
+		}
+		size_t delivered = 0;
+		while (delivered < 1001)
+		{
+			delivered += kaguya::drainMessages(state, queue, state["on_message"], 64);
+		}
+		for (size_t i = 0; i < producers.size(); ++i)
+		{
+			producers[i].join();
+		}
+		TEST_CHECK(queue.empty());
+		TEST_CHECK(state("assert(count == 1000 and #received == 1 and received[1].text == 'hello')"));
+
+		//errors in closure are reported and do not stop draining
+		state.setErrorHandler(ignore_error_fun);
+		queue.post([](lua_State* l) { luaL_error(l, "closure error"); });
+		queue.post([](lua_State*) { throw std::runtime_error("closure exception"); });
+		queue.post([](lua_State* l) { luaL_dostring(l, "count = count + 1"); });
+		TEST_CHECK(kaguya::drainMessages(state, queue, state["on_message"]) == 3);
+		TEST_CHECK(state("assert(count == 1001)"));
+	}
+#endif
+	struct FootprintVec
+	{
+		FootprintVec() :x(0), y(0), z(0) {}
+		float x, y, z;
+	};
+	void userdata_footprint(kaguya::State& state)
+	{
+		kaguya::TypeFootprint type = kaguya::typeFootprint<FootprintVec>();
+		TEST_CHECK(type.object_size == sizeof(FootprintVec));
+		TEST_CHECK(type.value_wrapper_size > type.object_size);
+		TEST_CHECK(type.valueOverhead() == type.value_wrapper_size - type.object_size);
+		TEST_CHECK(type.pointer_wrapper_size > 0 && type.shared_ptr_wrapper_size > 0);
+
+		state["FootprintVec"].setClass(kaguya::ClassMetatable<FootprintVec>()
+			.addConstructor()
+			);
+		TEST_CHECK(state("vecs = {} for i = 1,10 do vecs[i] = FootprintVec.new() end"));
+		FootprintVec local;
+		state["vec_pointer"] = &local;
+
+		kaguya::UserdataFootprintMap footprint = kaguya::userdataFootprint(state.state());
+		const kaguya::UserdataFootprint& vecs = footprint[kaguya::metatableName<FootprintVec>()];
+		TEST_CHECK(vecs.count == 11);
+		TEST_CHECK(vecs.bytes == 10 * type.value_wrapper_size + type.pointer_wrapper_size);
+		TEST_CHECK(footprint[kaguya::metatableName<kaguya::FunctorType>()].count > 0);
+
+		TEST_CHECK(state("vecs = nil vec_pointer = nil"));
+		footprint = kaguya::userdataFootprint(state.state());
+		TEST_CHECK(footprint[kaguya::metatableName<FootprintVec>()].count == 0);
+
+		TEST_CHECK(state("weak_values = setmetatable({FootprintVec.new()}, {__mode = 'v'})"));
+		TEST_CHECK(state("weak_keys = setmetatable({[FootprintVec.new()] = true}, {__mode = 'k'})"));
+		TEST_CHECK(state("strong = {FootprintVec.new()}"));
+		TEST_CHECK(state("local v = FootprintVec.new() co = coroutine.create(function() return v end)"));
+		footprint = kaguya::userdataFootprint(state.state());
+		TEST_CHECK(footprint[kaguya::metatableName<FootprintVec>()].count == 2);
+		TEST_CHECK(state("weak_values = nil weak_keys = nil strong = nil co = nil"));
+	}
+	void gc_controller(kaguya::State& state)
+	{
+		kaguya::GCController controller(state.state(), true);
+		TEST_CHECK(state("local t = {} for i = 1,50000 do t[i] = {i} end t = nil"));
+
+		kaguya::GCReport report = controller.step(0);
+		TEST_CHECK(report.steps == 1);
+		TEST_CHECK(report.allocated_bytes > 0);
+
+		size_t reclaimed = report.reclaimed_bytes;
+		int cycles = report.cycle_finished ? 1 : 0;
+		for (int i = 0; i < 100000 && cycles < 2; ++i)
+		{//objects allocated in running cycle may survive until next cycle
+			report = controller.step(0.001);
+			reclaimed += report.reclaimed_bytes;
+			cycles += report.cycle_finished ? 1 : 0;
+			TEST_CHECK(report.steps >= 1);
+		}
+		TEST_CHECK(cycles == 2);
+		TEST_CHECK(reclaimed > 0);
+		TEST_CHECK(report.used_bytes == controller.usedBytes());
+	}
+	void gc_controller_keeps_stopped(kaguya::State& state)
+	{
+#if LUA_VERSION_NUM >= 502
+		lua_gc(state.state(), LUA_GCSTOP, 0);
+		{
+			kaguya::GCController controller(state.state(), true);
+		}
+		TEST_CHECK(lua_gc(state.state(), LUA_GCISRUNNING, 0) == 0);
+		lua_gc(state.state(), LUA_GCRESTART, 0);
+		{
+			kaguya::GCController controller(state.state(), true);
+			TEST_CHECK(lua_gc(state.state(), LUA_GCISRUNNING, 0) == 0);
+		}
+		TEST_CHECK(lua_gc(state.state(), LUA_GCISRUNNING, 0) != 0);
+#endif
+	}
+	void execution_budget(kaguya::State& state)
+	{
+		state.setErrorHandler(record_error_message);
+		{
+			kaguya::ScopedExecutionBudget budget(state.state(), 100000);
+			TEST_CHECK(!state("while true do end"));
+			TEST_CHECK(budget.exceeded());
+			TEST_CHECK(recorded_error_message.find("execution budget exceeded") != std::string::npos);
+		}
+		{
+			kaguya::ScopedExecutionBudget budget(state.state(), 0, 0.01);
+			TEST_CHECK(!state("while true do end"));
+			TEST_CHECK(budget.exceeded());
+		}
+		{
+			kaguya::ScopedExecutionBudget budget(state.state(), 1000000);
+			TEST_CHECK(state("local n = 0 for i = 1,1000 do n = n + i end"));
+			TEST_CHECK(!budget.exceeded());
+		}
+		TEST_CHECK(lua_gethook(state.state()) == 0);
+		TEST_CHECK(state("local n = 0 for i = 1,1000000 do n = n + i end"));
+#if LUA_VERSION_NUM >= 502
+		{
+			lua_State* l = state.state();
+			kaguya::ScopedExecutionBudget budget(l, 10000, 0, kaguya::BUDGET_YIELD);
+			lua_State* co = lua_newthread(l);
+			luaL_loadstring(co, "local n = 0 while n < 100000 do n = n + 1 end result = n");
+			int resumes = 0;
+			int status = 0;
+			do
+			{
+				status = lua_resume(co, l, 0);
+				resumes++;
+			} while (status == LUA_YIELD && resumes < 10000);
+			lua_pop(l, 1);
+			TEST_CHECK(status == 0);
+			TEST_CHECK(resumes > 1);
+			TEST_CHECK(state["result"] == 100000);
+		}
+#endif
+	}
+	void profiler(kaguya::State& state)
+	{
+		state("function busy() local n = 0 for i = 1,100000 do n = n + i end return n end");
+		state("function outer() return busy() end");
+		kaguya::Profiler profiler(state.state(), 100);
+		profiler.start();
+		TEST_CHECK(profiler.running());
+		TEST_CHECK(state("outer()"));
+		profiler.stop();
+		TEST_CHECK(lua_gethook(state.state()) == 0);
+		TEST_CHECK(profiler.sampleCount() > 0);
+		std::string collapsed = profiler.collapsed();
+		TEST_CHECK(collapsed.find("outer (") != std::string::npos);
+		TEST_CHECK(collapsed.find(";busy (") != std::string::npos);
+
+		profiler.clear();
+		TEST_CHECK(profiler.sampleCount() == 0);
+		profiler.setTimerMode(true);
+		profiler.start();
+		TEST_CHECK(state("outer()"));
+		TEST_CHECK(profiler.sampleCount() == 0);
+		profiler.requestSample();
+		TEST_CHECK(state("outer()"));
+		profiler.stop();
+		TEST_CHECK(profiler.sampleCount() == 1);
+	}
+	void chunk_registry(kaguya::State& state)
+	{
+		kaguya::ChunkRegistry& registry = kaguya::ChunkRegistry::instance();
+		const std::string code = "local a = ... return (a or 1) * 2";
+		size_t size = registry.size();
+
+		kaguya::LuaFunction f = registry.loadstring(state.state(), code);
+		TEST_CHECK(f(21) == 42);
+		TEST_CHECK(registry.size() == size + 1);
+		{
+			kaguya::State other;
+			kaguya::LuaFunction g = registry.loadstring(other.state(), code);
+			TEST_CHECK(g(4) == 8);
+			TEST_CHECK(registry.size() == size + 1);
+		}
+
+		state.setErrorHandler(ignore_error_fun);
+		TEST_CHECK(registry.loadstring(state.state(), "syntax error(").isNilref());
+		TEST_CHECK(registry.size() == size + 1);
+
+		{
+			//same source with other chunk name is compiled again
+			kaguya::util::ScopedSavedStack save(state.state());
+			TEST_CHECK(registry.loadToStack(state.state(), code.data(), code.size(), "=named") == 0);
+			lua_Debug ar;
+			lua_getinfo(state.state(), ">S", &ar);
+			TEST_CHECK(std::string(ar.source) == "=named");
+		}
+
+		size_t max_entries = registry.maxSourceEntries();
+		registry.clear();
+		registry.setMaxSourceEntries(2);
+		TEST_CHECK(registry.loadstring(state.state(), "return 1")() == 1);
+		TEST_CHECK(registry.loadstring(state.state(), "return 2")() == 2);
+		TEST_CHECK(registry.loadstring(state.state(), "return 3")() == 3);
+		TEST_CHECK(registry.size() == 2);
+		registry.setMaxSourceEntries(max_entries);
+		TEST_CHECK(registry.loadstring(state.state(), code)(1) == 2);
+		TEST_CHECK(registry.size() == 3);
+
+#if KAGUYA_USE_CPP11
+		std::vector<std::thread> threads;
+		std::vector<int> results(4, 0);
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			threads.push_back(std::thread([&results, &code, i]()
+			{
+				kaguya::State worker;
+				results[i] = kaguya::ChunkRegistry::instance().loadstring(worker.state(), code)(int(i));
+			}));
+		}
+		for (size_t i = 0; i < threads.size(); ++i)
+		{
+			threads[i].join();
+		}
+		TEST_CHECK(results[3] == 6);
+		TEST_CHECK(registry.size() == 3);
 #endif
 	}
 }
@@ -1217,6 +1929,175 @@ namespace t_07_any_type_test
 		}
 	}
 }
+namespace t_08_scheduler
+{
+	void round_robin(kaguya::State& state)
+	{
+		kaguya::CoroutineScheduler scheduler(state.state());
+		state["sched"] = scheduler.library();
+		state("order = {}");
+		state("task = function(name) return function() for i=1,2 do table.insert(order, name) coroutine.yield() end end end");
+		scheduler.spawn(state["task"]("a"));
+		scheduler.spawn(state["task"]("b"));
+		scheduler.spawn(state["task"]("c"), 1);
+		while (!scheduler.empty())
+		{
+			scheduler.update(0);
+		}
+		TEST_CHECK(state("assert(table.concat(order) == 'cabcab')"));
+	}
+	void sleep_and_event(kaguya::State& state)
+	{
+		kaguya::CoroutineScheduler scheduler(state.state());
+		state["sched"] = scheduler.library();
+		kaguya::CoroutineScheduler::TaskId sleeper = scheduler.spawn(state.loadstring("sched.sleep(1.0) woke = true"));
+		scheduler.spawn(state.loadstring("notified = sched.wait(3) timeout = sched.wait(4, 0.5)"));
+		scheduler.update(0);
+		TEST_CHECK(scheduler.status(sleeper) == kaguya::CoroutineScheduler::TASK_SLEEPING);
+		TEST_CHECK(scheduler.notify(3) == 1);
+		scheduler.update(0.5);
+		TEST_CHECK(state("assert(notified == true and woke == nil)"));
+		TEST_CHECK(scheduler.waitingCount(3) == 0);
+		TEST_CHECK(scheduler.waitingCount(4) == 1);
+		scheduler.update(1.0);
+		TEST_CHECK(state("assert(timeout == false and woke == true)"));
+		TEST_CHECK(scheduler.waitingCount(4) == 0);
+		TEST_CHECK(scheduler.empty());
+
+		//waiter list of event is reused by every wait
+		scheduler.spawn(state.loadstring("for i=1,3 do sched.wait(5) end"));
+		for (int i = 0; i < 3; ++i)
+		{
+			scheduler.update(1.0);
+			TEST_CHECK(scheduler.waitingCount(5) == 1);
+			TEST_CHECK(scheduler.notify(5) == 1);
+		}
+		scheduler.update(1.0);
+		TEST_CHECK(scheduler.empty());
+	}
+	kaguya::AsyncResult<std::string> pending_result;
+	void async_fetch(kaguya::VariadicArgType args, kaguya::AsyncResult<std::string> result)
+	{
+		if (args.empty())
+		{
+			result.fail("no argument");
+			return;
+		}
+		pending_result = result;
+	}
+	void async_callback(kaguya::State& state)
+	{
+		kaguya::CoroutineScheduler scheduler(state.state());
+		state["fetch"] = kaguya::async_callback<std::string>(scheduler, &async_fetch);
+		scheduler.spawn(state.loadstring("value = fetch('key') ok, err = fetch()"));
+		scheduler.update(0);
+		TEST_CHECK(scheduler.hasPendingOperation());
+		scheduler.update(0);
+		TEST_CHECK(state("assert(value == nil)"));
+		pending_result.set("result");
+		scheduler.update(0);
+		scheduler.update(0);
+		TEST_CHECK(state("assert(value == 'result')"));
+		TEST_CHECK(state("assert(ok == nil and err == 'no argument')"));
+		TEST_CHECK(scheduler.empty());
+		pending_result = kaguya::AsyncResult<std::string>();
+	}
+#if KAGUYA_USE_CPP11
+	void async_future(kaguya::State& state)
+	{
+		kaguya::CoroutineScheduler scheduler(state.state());
+		state["twice"] = kaguya::async_future(scheduler, [](kaguya::VariadicArgType args) {
+			int v = args[0];
+			return std::async(std::launch::async, [v]() { return v * 2; });
+		});
+		scheduler.spawn(state.loadstring("a = twice(2)"));
+		scheduler.spawn(state.loadstring("b = twice(21)"));
+		kaguya::run_event_loop(scheduler);
+		TEST_CHECK(state("assert(a == 4 and b == 42)"));
+
+		state["fail"] = kaguya::async_future(scheduler, [](kaguya::VariadicArgType) {
+			return std::async(std::launch::async, []() -> int { throw 1; });
+		});
+		scheduler.spawn(state.loadstring("c, err = fail()"));
+		kaguya::run_event_loop(scheduler);
+		TEST_CHECK(state("assert(c == nil and err == 'Unknown exception')"));
+	}
+#endif
+}
+namespace t_09_serializer
+{
+	void ignore_error_fun(int status, const char* message)
+	{
+	}
+	void roundtrip(kaguya::State& state)
+	{
+		TEST_CHECK(state("value = {1, 2.5, 'str\\0ing', true, nested = {x = -7}, [10] = false, big = string.rep('x', 10000)}"
+			"value.self = value value.alias = value.nested"));
+		kaguya::Serializer serializer;
+		std::string data;
+		TEST_CHECK(serializer.serialize(state["value"], data));
+
+		kaguya::State other;
+		other.setErrorHandler(ignore_error_fun);
+		other["copy"] = serializer.deserialize(other.state(), data);
+		TEST_CHECK(other("assert(copy[1] == 1 and copy[2] == 2.5 and copy[3] == 'str\\0ing' and copy[4] == true)"));
+		TEST_CHECK(other("assert(copy.nested.x == -7 and copy[10] == false and #copy.big == 10000)"));
+		TEST_CHECK(other("assert(copy.self == copy and copy.alias == copy.nested)"));
+#if LUA_VERSION_NUM >= 503
+		TEST_CHECK(other("assert(math.type(copy[1]) == 'integer' and math.type(copy[2]) == 'float')"));
+#endif
+
+		TEST_CHECK(serializer.deserialize(other.state(), data.substr(0, data.size() / 2)).isNilref());
+		const char nil_key[] = { 1, 6, 0, 2, 7 };//{[nil] = true}
+		TEST_CHECK(serializer.deserialize(other.state(), std::string(nil_key, sizeof(nil_key))).isNilref());
+		const char nan_key[] = { 1, 6, 4, 0, 0, 0, 0, 0, 0, char(0xF8), char(0x7F), 2, 7 };//{[0/0] = true}
+		TEST_CHECK(serializer.deserialize(other.state(), std::string(nan_key, sizeof(nan_key))).isNilref());
+		state.setErrorHandler(ignore_error_fun);
+		TEST_CHECK(state("value.fn = print"));
+		std::string partial;
+		TEST_CHECK(!serializer.serialize(state["value"], partial));
+	}
+
+	struct Point
+	{
+		Point(int px = 0, int py = 0) :x(px), y(py) {}
+		int getX()const { return x; }
+		int getY()const { return y; }
+		int x;
+		int y;
+	};
+	kaguya::LuaRef encode_point(const kaguya::LuaRef& value)
+	{
+		Point point = value.get<Point>();
+		return kaguya::LuaRef(value.state(), point.x * 1000 + point.y);
+	}
+	kaguya::LuaRef decode_point(const kaguya::LuaRef& value)
+	{
+		int packed = value.get<int>();
+		return kaguya::LuaRef(value.state(), Point(packed / 1000, packed % 1000));
+	}
+	void userdata_hook(kaguya::State& state)
+	{
+		kaguya::State other;
+		state["Point"].setClass(kaguya::ClassMetatable<Point>()
+			.addConstructor<int, int>()
+			.addMember("getX", &Point::getX)
+			.addMember("getY", &Point::getY));
+		other["Point"].setClass(kaguya::ClassMetatable<Point>()
+			.addConstructor<int, int>()
+			.addMember("getX", &Point::getX)
+			.addMember("getY", &Point::getY));
+
+		kaguya::Serializer serializer;
+		serializer.addUserdataHook<Point>(encode_point, decode_point);
+		TEST_CHECK(state("points = { Point.new(1, 2), Point.new(3, 4) }"));
+		std::string data;
+		TEST_CHECK(serializer.serialize(state["points"], data));
+		other["points"] = serializer.deserialize(other.state(), data);
+		TEST_CHECK(other("assert(points[1]:getX() == 1 and points[2]:getY() == 4)"));
+	}
+}
+
 void test_error_handler(int status, const char* message)
 {
 	throw std::runtime_error(std::string(message));
@@ -1334,6 +2215,10 @@ int main()
 		ADD_TEST(t_02_classreg::registering_derived_class);
 		ADD_TEST(t_02_classreg::registering_shared_ptr);
 		ADD_TEST(t_02_classreg::add_property);
+		ADD_TEST(t_02_classreg::type_name);
+#if KAGUYA_ENABLE_INSTRUMENTATION
+		ADD_TEST(t_02_classreg::instrumentation);
+#endif
 		
 
 		ADD_TEST(t_03_function::free_standing_function_test);
@@ -1347,6 +2232,9 @@ int main()
 #if KAGUYA_USE_CPP11
 		ADD_TEST(t_03_function::lambdafun);
 #endif
+#if KAGUYA_USE_VARIADIC_TEMPLATE
+		ADD_TEST(t_03_function::many_arguments);
+#endif
 
 		ADD_TEST(t_04_lua_ref::access);
 		ADD_TEST(t_04_lua_ref::newtable);
@@ -1364,18 +2252,48 @@ int main()
 		ADD_TEST(t_04_lua_ref::luafun_loadstring);
 
 		ADD_TEST(t_04_lua_ref::metatable);
+		ADD_TEST(t_04_lua_ref::try_get);
 
 		ADD_TEST(t_05_error_handler::set_error_function);
 		ADD_TEST(t_05_error_handler::function_call_error);
+		ADD_TEST(t_05_error_handler::handler_per_state);
+		ADD_TEST(t_05_error_handler::handler_replaces_itself);
 
 		ADD_TEST(t_06_state::other_state);
 		ADD_TEST(t_06_state::load_string);
 		ADD_TEST(t_06_state::load_with_other_env);
 		ADD_TEST(t_06_state::no_standard_lib);
 		ADD_TEST(t_06_state::load_lib_constructor);
+		ADD_TEST(t_06_state::allocator_constructor);
+		ADD_TEST(t_06_state::memory_limit);
+		ADD_TEST(t_06_state::bytecode_cache);
+		ADD_TEST(t_06_state::chunk_registry);
+		ADD_TEST(t_06_state::mapped_loadfile);
+		ADD_TEST(t_06_state::state_pool);
+		ADD_TEST(t_06_state::userdata_footprint);
+		ADD_TEST(t_06_state::gc_controller);
+		ADD_TEST(t_06_state::gc_controller_keeps_stopped);
+		ADD_TEST(t_06_state::execution_budget);
+		ADD_TEST(t_06_state::profiler);
+#if KAGUYA_USE_CPP11 && KAGUYA_USE_VARIADIC_TEMPLATE
+		ADD_TEST(t_06_state::executor);
+#endif
+#if KAGUYA_USE_CPP11
+		ADD_TEST(t_06_state::message_queue);
+#endif
 		
 		ADD_TEST(t_07_any_type_test::any_type_test);
 
+		ADD_TEST(t_08_scheduler::round_robin);
+		ADD_TEST(t_08_scheduler::sleep_and_event);
+		ADD_TEST(t_08_scheduler::async_callback);
+#if KAGUYA_USE_CPP11
+		ADD_TEST(t_08_scheduler::async_future);
+#endif
+
+		ADD_TEST(t_09_serializer::roundtrip);
+		ADD_TEST(t_09_serializer::userdata_hook);
+
 		test_result = execute_test(testmap);
 	}
 	return test_result ? 0 : -1;
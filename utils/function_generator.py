@@ -42,7 +42,7 @@ def arg_typenames(arg_num):
 		result +='    result+='
 		if i>1:
 			result +='std::string(",")+'
-		result +='typeid(T'+ str(i)+').name();\n'
+		result +='util::typeName<T'+ str(i)+'>();\n'
 	result +='    return result;\n'
 	result +='  }\n'
 	return result